@@ -269,7 +269,42 @@ typedef enum {
   OP_SYMTAG,  /* obsolete */
   OP_BREAK,
   /* ----- */
-  OP_NUM_OPCODES
+  OP_NUM_OPCODES,
+  /* internal opcodes (GNU C version of amx_Exec() only), these are never
+   * found in a file but created after loading; superinstructions replace the
+   * opcode of the first instruction of a pair
+   */
+  OP_PUSH_PRI_PUSH_C = OP_NUM_OPCODES,
+  OP_CONST_PRI_PUSH_PRI,
+  OP_LOAD_S_PRI_PUSH_PRI,
+  OP_ADDR_PRI_PUSH_PRI,
+  OP_PUSH_C_SYSREQ_C,
+  OP_PUSH_C_CALL,
+  OP_ZERO_PRI_RETN,
+  /* direct native calls (GNU C version only), see amx_GetNativeCalls() */
+  OP_SYSREQ_N,
+  OP_PUSH_C_SYSREQ_N,
+  /* superinstructions for expressions and loops */
+  OP_LOAD_S_ALT_LOAD_S_PRI,
+  OP_LOAD_S_PRI_CONST_ALT,
+  OP_LOAD_S_PRI_ADD_C,
+  OP_LOAD_S_PRI_BOUNDS,
+  OP_ADD_STOR_S_PRI,
+  OP_INC_S_JUMP,
+  /* STACK and HEAP without the checks that are redundant for code that has
+   * passed verification (see AMXVerifier in the plugin)
+   */
+  OP_STACK_ALLOC,
+  OP_STACK_FREE,
+  OP_HEAP_ALLOC,
+  OP_HEAP_FREE,
+  /* BOUNDS whose index has been proven to be in range when the script was
+   * loaded, the operand is kept for disassemblers
+   */
+  OP_BOUNDS_NOP,
+  OP_LOAD_S_PRI_BOUNDS_NOP,
+  /* ----- */
+  OP_NUM_OPCODES_INTERNAL
 } OPCODE;
 
 #define USENAMETABLE(hdr) \
@@ -506,6 +541,61 @@ int AMXAPI amx_Callback(AMX *amx, cell index, cell *result, cell *params)
 
 #define DBGPARAM(v)     ( (v)=*(cell *)(code+(int)cip), cip+=sizeof(cell) )
 
+/* Sorts the records of a case table by their values, so that OP_SWITCH can
+ * use a binary search (see findcase()). The Pawn compiler already emits the
+ * records in ascending order, so normally there is nothing to do.
+ * "casetbl" points at the first operand of OP_CASETBL: the number of records,
+ * followed by the default address and the records themselves.
+ */
+void AMXAPI amx_SortCaseTable(cell *casetbl)
+{
+  cell num=casetbl[0];
+  cell *records=casetbl+2;
+  cell i,j,value,address;
+
+  for (i=1; i<num; i++) {
+    value=records[2*i];
+    address=records[2*i+1];
+    for (j=i; j>0 && records[2*(j-1)]>value; j--) {
+      records[2*j]=records[2*(j-1)];
+      records[2*j+1]=records[2*(j-1)+1];
+    } /* for */
+    records[2*j]=value;
+    records[2*j+1]=address;
+  } /* for */
+}
+
+/* Finds the record for "value" in a sorted case table; "records" points at
+ * the first record. If the values are contiguous, the table is indexed
+ * directly, otherwise a binary search is done. Returns NULL if no record
+ * matches.
+ */
+static cell *findcase(cell *records, cell num, cell value)
+{
+  cell low,high,mid;
+
+  if (num<=0)
+    return NULL;
+  if ((ucell)records[2*(num-1)]-(ucell)records[0]==(ucell)(num-1)) {
+    /* dense table (the values are unique, so first..last is contiguous) */
+    if ((ucell)value-(ucell)records[0]<(ucell)num)
+      return records+2*(value-records[0]);
+    return NULL;
+  } /* if */
+  low=0;
+  high=num-1;
+  while (low<=high) {
+    mid=low+(high-low)/2;
+    if (records[2*mid]<value)
+      low=mid+1;
+    else if (records[2*mid]>value)
+      high=mid-1;
+    else
+      return records+2*mid;
+  } /* while */
+  return NULL;
+}
+
 #if defined AMX_INIT
 
 static int amx_BrowseRelocate(AMX *amx)
@@ -746,6 +836,7 @@ static int amx_BrowseRelocate(AMX *amx)
           reloc_count++;
         #endif
       } /* for */
+      amx_SortCaseTable((cell *)(code+(int)cip)-1);
       cip+=(2*num + 1)*sizeof(cell);
       break;
     } /* case */
@@ -1673,6 +1764,12 @@ int AMXAPI amx_RaiseExecError(AMX *amx, cell index, cell *retval, int error) {
   return AMX_ERR_NOTFOUND;
 }
 
+static AMX_NATIVECALL *amx_nativecalls = NULL;
+
+const AMX_NATIVECALL * AMXAPI amx_GetNativeCalls(void) {
+  return amx_nativecalls;
+}
+
 int AMXAPI amx_GetExecErrorHandler(AMX *amx, AMX_EXEC_ERROR *handler) {
   assert(amx!=NULL);
   assert(handler!=NULL);
@@ -1688,6 +1785,32 @@ int AMXAPI amx_SetExecErrorHandler(AMX *amx, AMX_EXEC_ERROR handler) {
 }
 
 
+/* Sets "count" cells at "dest" to "value" (OP_FILL). Values made of one
+ * repeated byte (like 0 and -1, by far the most common) are a memset();
+ * for anything else the first few cells are written directly and then
+ * copied over in ever larger blocks, so that the bulk of the work is done
+ * by memcpy().
+ */
+static void fillcells(unsigned char *dest,cell value,size_t count)
+{
+  const size_t maxblock=256;    /* cells, small enough to stay in L1 */
+  unsigned char byte=(unsigned char)value;
+  size_t done,block;
+
+  if ((ucell)value==(ucell)byte*((ucell)~(ucell)0/0xff)) {
+    memset(dest,byte,count*sizeof(cell));
+    return;
+  } /* if */
+  for (done=0; done<count && done<16; done++)
+    ((cell *)dest)[done]=value;
+  for ( ; done<count; done+=block) {
+    block=done<maxblock ? done : maxblock;
+    if (block>count-done)
+      block=count-done;
+    memcpy(dest+done*sizeof(cell),dest,block*sizeof(cell));
+  } /* for */
+}
+
 #define GETPARAM(v)     ( v=*(cell *)cip++ )
 #define SKIPPARAM(n)    ( cip=(cell *)cip+(n) )
 #define PUSH(v)         ( stk-=sizeof(cell), *(cell *)(data+(int)stk)=v )
@@ -1711,6 +1834,14 @@ int AMXAPI amx_SetExecErrorHandler(AMX *amx, AMX_EXEC_ERROR handler) {
      */
 
 #define NEXT(cip)       do { (amx)->cip=(cell)cip-(cell)code; goto **cip++; } while (0)
+/* A superinstruction replaces only the opcode of the first instruction of a
+ * pair, the second one is left in place. So after doing the first part, we
+ * skip the second opcode and go straight to its handler. Code addresses do
+ * not change, jumps to the second instruction still work and amx->cip is
+ * kept the same as if the two instructions were executed separately.
+ */
+#define NEXT_SUPER(cip,label) \
+                        do { (amx)->cip=(cell)cip-(cell)code; cip++; goto label; } while (0)
 
 int AMXAPI amx_Exec(AMX *amx, cell *retval, int index)
 {
@@ -1749,7 +1880,23 @@ static const void * const amx_opcodelist[] = {
         &&op_file,      &&op_line,      &&op_symbol,    &&op_srange,
         &&op_jump_pri,  &&op_switch,    &&op_casetbl,   &&op_swap_pri,
         &&op_swap_alt,  &&op_pushaddr,  &&op_nop,       &&op_sysreq_d,
-        &&op_symtag,    &&op_break };
+        &&op_symtag,    &&op_break,
+        /* superinstructions */
+        &&op_push_pri_push_c,           &&op_const_pri_push_pri,
+        &&op_load_s_pri_push_pri,       &&op_addr_pri_push_pri,
+        &&op_push_c_sysreq_c,           &&op_push_c_call,
+        &&op_zero_pri_retn,
+        /* direct native calls */
+        &&op_sysreq_n,                  &&op_push_c_sysreq_n,
+        /* superinstructions for expressions and loops */
+        &&op_load_s_alt_load_s_pri,     &&op_load_s_pri_const_alt,
+        &&op_load_s_pri_add_c,          &&op_load_s_pri_bounds,
+        &&op_add_stor_s_pri,            &&op_inc_s_jump,
+        /* verified STACK and HEAP */
+        &&op_stack_alloc,               &&op_stack_free,
+        &&op_heap_alloc,                &&op_heap_free,
+        /* proven BOUNDS */
+        &&op_bounds_nop,                &&op_load_s_pri_bounds_nop };
   AMX_HEADER *hdr;
   AMX_FUNCSTUB *func;
   unsigned char *code, *data;
@@ -1757,7 +1904,7 @@ static const void * const amx_opcodelist[] = {
   cell reset_stk, reset_hea, *cip;
   cell offs;
   ucell codesize;
-  int num,i;
+  int num;
 
   /* HACK: return label table (for amx_BrowseRelocate) if amx structure
    * has the AMX_FLAG_BROWSE flag set.
@@ -2464,8 +2611,8 @@ static const void * const amx_opcodelist[] = {
       ABORT(amx,AMX_ERR_MEMACCESS);
     if ((alt+offs)>hea && (alt+offs)<stk || (ucell)(alt+offs)>(ucell)amx->stp)
       ABORT(amx,AMX_ERR_MEMACCESS);
-    for (i=(int)alt; offs>=(int)sizeof(cell); i+=sizeof(cell), offs-=sizeof(cell))
-      *(cell *)(data+i) = pri;
+    if (offs>0)
+      fillcells(data+(int)alt,pri,(size_t)offs/sizeof(cell));
     NEXT(cip);
   op_halt:
     GETPARAM(offs);
@@ -2568,10 +2715,8 @@ static const void * const amx_opcodelist[] = {
     cell *cptr;
     cptr=JUMPABS(code,cip)+1;   /* +1, to skip the "casetbl" opcode */
     cip=JUMPABS(code,cptr+1);   /* preset to "none-matched" case */
-    num=(int)*cptr;             /* number of records in the case table */
-    for (cptr+=2; num>0 && *cptr!=pri; num--,cptr+=2)
-      /* nothing */;
-    if (num>0)
+    cptr=findcase(cptr+2,*cptr,pri);
+    if (cptr!=NULL)
       cip=JUMPABS(code,cptr+1); /* case found */
     NEXT(cip);
     }
@@ -2614,6 +2759,126 @@ static const void * const amx_opcodelist[] = {
       } /* if */
     } /* if */
     NEXT(cip);
+  op_push_pri_push_c:
+    PUSH(pri);
+    NEXT_SUPER(cip,op_push_c);
+  op_const_pri_push_pri:
+    GETPARAM(pri);
+    NEXT_SUPER(cip,op_push_pri);
+  op_load_s_pri_push_pri:
+    GETPARAM(offs);
+    pri= * (cell *)(data+(int)frm+(int)offs);
+    NEXT_SUPER(cip,op_push_pri);
+  op_addr_pri_push_pri:
+    GETPARAM(pri);
+    pri+=frm;
+    NEXT_SUPER(cip,op_push_pri);
+  op_push_c_sysreq_c:
+    GETPARAM(offs);
+    PUSH(offs);
+    NEXT_SUPER(cip,op_sysreq_c);
+  op_push_c_call:
+    GETPARAM(offs);
+    PUSH(offs);
+    NEXT_SUPER(cip,op_call);
+  op_zero_pri_retn:
+    pri=0;
+    NEXT_SUPER(cip,op_retn);
+  op_push_c_sysreq_n:
+    GETPARAM(offs);
+    PUSH(offs);
+    NEXT_SUPER(cip,op_sysreq_n);
+  op_sysreq_n: {
+    AMX_NATIVECALL call;
+    GETPARAM(offs);
+    /* save a few registers */
+    amx->cip=(cell)((unsigned char *)cip-code);
+    amx->hea=hea;
+    amx->frm=frm;
+    amx->stk=stk;
+    func=GETENTRY(hdr,natives,offs);
+    if (func->address!=0) {
+      /* call the native directly, keeping a record for backtraces */
+      call.prev=amx_nativecalls;
+      call.amx=amx;
+      call.index=offs;
+      amx_nativecalls=&call;
+      amx->error=AMX_ERR_NONE;
+      pri=((AMX_NATIVE)func->address)(amx,(cell *)(data+(int)stk));
+      amx_nativecalls=call.prev;
+      num=amx->error;
+    } else {
+      /* not registered (yet), let the callback report it */
+      num=amx->callback(amx,offs,&pri,(cell *)(data+(int)stk));
+    } /* if */
+    if (num!=AMX_ERR_NONE) {
+      if (num==AMX_ERR_SLEEP) {
+        amx->pri=pri;
+        amx->alt=alt;
+        amx->reset_stk=reset_stk;
+        amx->reset_hea=reset_hea;
+        return num;
+      } /* if */
+      ABORT(amx,num);
+    } /* if */
+    NEXT(cip);
+  }
+  op_load_s_alt_load_s_pri:
+    GETPARAM(offs);
+    alt= * (cell *)(data+(int)frm+(int)offs);
+    NEXT_SUPER(cip,op_load_s_pri);
+  op_load_s_pri_const_alt:
+    GETPARAM(offs);
+    pri= * (cell *)(data+(int)frm+(int)offs);
+    NEXT_SUPER(cip,op_const_alt);
+  op_load_s_pri_add_c:
+    GETPARAM(offs);
+    pri= * (cell *)(data+(int)frm+(int)offs);
+    NEXT_SUPER(cip,op_add_c);
+  op_load_s_pri_bounds:
+    GETPARAM(offs);
+    pri= * (cell *)(data+(int)frm+(int)offs);
+    NEXT_SUPER(cip,op_bounds);
+  op_add_stor_s_pri:
+    pri+=alt;
+    NEXT_SUPER(cip,op_stor_s_pri);
+  op_inc_s_jump:
+    GETPARAM(offs);
+    *(cell *)(data+(int)frm+(int)offs) += 1;
+    NEXT_SUPER(cip,op_jump);
+  op_stack_alloc:
+    /* a negative operand can't underflow the stack */
+    GETPARAM(offs);
+    alt=stk;
+    stk+=offs;
+    CHKMARGIN();
+    NEXT(cip);
+  op_stack_free:
+    /* a positive operand can't run into the heap, and the verifier has
+     * checked that the function doesn't free more than it has allocated
+     */
+    GETPARAM(offs);
+    alt=stk;
+    stk+=offs;
+    NEXT(cip);
+  op_heap_alloc:
+    GETPARAM(offs);
+    alt=hea;
+    hea+=offs;
+    CHKMARGIN();
+    NEXT(cip);
+  op_heap_free:
+    GETPARAM(offs);
+    alt=hea;
+    hea+=offs;
+    NEXT(cip);
+  op_bounds_nop:
+    SKIPPARAM(1);
+    NEXT(cip);
+  op_load_s_pri_bounds_nop:
+    GETPARAM(offs);
+    pri= * (cell *)(data+(int)frm+(int)offs);
+    NEXT_SUPER(cip,op_bounds_nop);
 }
 
 #else
@@ -3441,8 +3706,8 @@ int AMXAPI amx_Exec(AMX *amx, cell *retval, int index)
         ABORT(amx,AMX_ERR_MEMACCESS);
       if ((alt+offs)>hea && (alt+offs)<stk || (ucell)(alt+offs)>(ucell)amx->stp)
         ABORT(amx,AMX_ERR_MEMACCESS);
-      for (i=(int)alt; (size_t)offs>=sizeof(cell); i+=sizeof(cell), offs-=sizeof(cell))
-        *(cell *)(data+i) = pri;
+      if (offs>0)
+        fillcells(data+(int)alt,pri,(size_t)offs/sizeof(cell));
       break;
     case OP_HALT:
       GETPARAM(offs);
@@ -3538,10 +3803,8 @@ int AMXAPI amx_Exec(AMX *amx, cell *retval, int index)
 
       cptr=JUMPABS(code,cip)+1; /* +1, to skip the "casetbl" opcode */
       cip=JUMPABS(code,cptr+1); /* preset to "none-matched" case */
-      num=(int)*cptr;           /* number of records in the case table */
-      for (cptr+=2; num>0 && *cptr!=pri; num--,cptr+=2)
-        /* nothing */;
-      if (num>0)
+      cptr=findcase(cptr+2,*cptr,pri);
+      if (cptr!=NULL)
         cip=JUMPABS(code,cptr+1); /* case found */
       break;
     } /* case */
@@ -283,6 +283,16 @@ typedef struct tagAMX_HEADER {
   int32_t nametable     PACKED; /* name table */
 } PACKED AMX_HEADER;
 
+/* The record of a native function call made directly by the internal
+ * "sysreq.n" instruction, which bypasses the callback. Records of all active
+ * calls are linked together, the innermost call first.
+ */
+typedef struct tagAMX_NATIVECALL {
+  struct tagAMX_NATIVECALL *prev;
+  struct tagAMX *amx;
+  cell index;
+} AMX_NATIVECALL;
+
 #if PAWN_CELL_SIZE==16
   #define AMX_MAGIC     0xf1e2
 #elif PAWN_CELL_SIZE==32
@@ -384,6 +394,7 @@ int AMXAPI amx_Flags(AMX *amx,uint16_t *flags);
 int AMXAPI amx_GetAddr(AMX *amx,cell amx_addr,cell **phys_addr);
 int AMXAPI amx_GetExecErrorHandler(AMX *amx, AMX_EXEC_ERROR *handler);
 int AMXAPI amx_GetNative(AMX *amx, int index, char *funcname);
+const AMX_NATIVECALL * AMXAPI amx_GetNativeCalls(void);
 int AMXAPI amx_GetPublic(AMX *amx, int index, char *funcname);
 int AMXAPI amx_GetPubVar(AMX *amx, int index, char *varname, cell *amx_addr);
 int AMXAPI amx_GetString(char *dest,const cell *source, int use_wchar, size_t size);
@@ -410,6 +421,7 @@ int AMXAPI amx_SetDebugHook(AMX *amx, AMX_DEBUG debug);
 int AMXAPI amx_SetExecErrorHandler(AMX *amx, AMX_EXEC_ERROR handler);
 int AMXAPI amx_SetString(cell *dest, const char *source, int pack, int use_wchar, size_t size);
 int AMXAPI amx_SetUserData(AMX *amx, long tag, void *ptr);
+void AMXAPI amx_SortCaseTable(cell *casetbl);
 int AMXAPI amx_StrLen(const cell *cstring, int *length);
 int AMXAPI amx_UTF8Check(const char *string, int *length);
 int AMXAPI amx_UTF8Get(const char *string, const char **endptr, cell *value);
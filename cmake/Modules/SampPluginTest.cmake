@@ -50,6 +50,7 @@ function(add_samp_plugin_test)
 	)
 
 	file(READ "${ARG_OUT_FILE}" out)
+	get_filename_component(script_dir "${ARG_SCRIPT}" PATH)
 
 	if(WIN32)
 		add_test(${name} samp-server-cli.bat ${arguments})
@@ -58,7 +59,7 @@ function(add_samp_plugin_test)
 	endif()
 
 	set_tests_properties(${name} PROPERTIES
-		ENVIRONMENT "AMX_PATH=${CMAKE_CURRENT_SOURCE_DIR}/${name}"
+		ENVIRONMENT "AMX_PATH=${script_dir}"
 		PASS_REGULAR_EXPRESSION "${out}"
 	)
 endfunction()
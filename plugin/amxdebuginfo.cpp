@@ -22,6 +22,7 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -65,12 +66,67 @@ bool AMXDebugInfo::IsLoaded() const {
   return (amxdbg_ != 0);
 }
 
+template<typename T>
+static void Rebase(T *&ptr, unsigned char *old_base, unsigned char *new_base,
+                   std::size_t shift) {
+  unsigned char *old_ptr = reinterpret_cast<unsigned char*>(ptr);
+  ptr = reinterpret_cast<T*>(new_base + (old_ptr - old_base) - shift);
+}
+
+// Removes the line table from the memory block that dbg_LoadInfo() reads
+// all tables into, once it has been copied to an AMXLineTable.
+static void DropLineTable(AMX_DBG *amxdbg) {
+  AMX_DBG_HDR *hdr = amxdbg->hdr;
+  std::size_t lines_size = hdr->lines * sizeof(AMX_DBG_LINE);
+  if (lines_size == 0) {
+    return;
+  }
+
+  unsigned char *base = reinterpret_cast<unsigned char*>(hdr);
+  unsigned char *lines = reinterpret_cast<unsigned char*>(amxdbg->linetbl);
+  std::size_t head_size = lines - base;
+  std::size_t tail_size = hdr->size - head_size - lines_size;
+
+  unsigned char *new_base = reinterpret_cast<unsigned char*>(
+    std::malloc(head_size + tail_size));
+  if (new_base == 0) {
+    return;
+  }
+  std::memcpy(new_base, base, head_size);
+  std::memcpy(new_base + head_size, lines + lines_size, tail_size);
+
+  // Tables that come after the line table move by lines_size less.
+  for (int i = 0; i < hdr->files; i++) {
+    Rebase(amxdbg->filetbl[i], base, new_base, 0);
+  }
+  for (int i = 0; i < hdr->symbols; i++) {
+    Rebase(amxdbg->symboltbl[i], base, new_base, lines_size);
+  }
+  for (int i = 0; i < hdr->tags; i++) {
+    Rebase(amxdbg->tagtbl[i], base, new_base, lines_size);
+  }
+  for (int i = 0; i < hdr->automatons; i++) {
+    Rebase(amxdbg->automatontbl[i], base, new_base, lines_size);
+  }
+  for (int i = 0; i < hdr->states; i++) {
+    Rebase(amxdbg->statetbl[i], base, new_base, lines_size);
+  }
+
+  std::free(base);
+  amxdbg->hdr = reinterpret_cast<AMX_DBG_HDR*>(new_base);
+  amxdbg->hdr->size -= static_cast<uint32_t>(lines_size);
+  amxdbg->hdr->lines = 0;
+  amxdbg->linetbl = 0;
+}
+
 void AMXDebugInfo::Load(const std::string &filename) {
   std::FILE* fp = std::fopen(filename.c_str(), "rb");
   if (fp != 0) {
     AMX_DBG amxdbg;
     if (dbg_LoadInfo(&amxdbg, fp) == AMX_ERR_NONE) {
       amxdbg_ = new AMX_DBG(amxdbg);
+      lines_.Build(amxdbg_->linetbl, amxdbg_->hdr->lines);
+      DropLineTable(amxdbg_);
     }
     fclose(fp);
   }
@@ -80,21 +136,54 @@ void AMXDebugInfo::Free() {
   if (amxdbg_ != 0) {
     dbg_FreeInfo(amxdbg_);
     delete amxdbg_;
+    amxdbg_ = 0;
+  }
+  lines_.Clear();
+}
+
+void AMXDebugInfo::Swap(AMXDebugInfo &other) {
+  std::swap(amxdbg_, other.amxdbg_);
+  lines_.Swap(other.lines_);
+}
+
+static cell MapAddress(const std::vector<cell> &removed, cell address) {
+  std::vector<cell>::const_iterator it =
+    std::lower_bound(removed.begin(), removed.end(), address);
+  return address - static_cast<cell>(it - removed.begin()) * sizeof(cell);
+}
+
+void AMXDebugInfo::RemoveCode(const std::vector<cell> &addresses) {
+  if (amxdbg_ == 0 || addresses.empty()) {
+    return;
+  }
+  for (int i = 0; i < amxdbg_->hdr->files; i++) {
+    AMX_DBG_FILE *file = amxdbg_->filetbl[i];
+    file->address = MapAddress(addresses, file->address);
+  }
+  std::vector<AMX_DBG_LINE> lines;
+  lines_.GetLines(lines);
+  for (std::size_t i = 0; i < lines.size(); i++) {
+    lines[i].address = MapAddress(addresses, lines[i].address);
+  }
+  if (!lines.empty()) {
+    lines_.Build(&lines[0], static_cast<int>(lines.size()));
+  }
+  for (int i = 0; i < amxdbg_->hdr->symbols; i++) {
+    AMX_DBG_SYMBOL *symbol = amxdbg_->symboltbl[i];
+    if (symbol->ident == iFUNCTN) {
+      symbol->address = MapAddress(addresses, symbol->address);
+    }
+    symbol->codestart = MapAddress(addresses, symbol->codestart);
+    symbol->codeend = MapAddress(addresses, symbol->codeend);
   }
 }
 
 AMXDebugLine AMXDebugInfo::GetLine(cell address) const {
-  Line line;
-  LineTable lines = GetLines();
-  LineTable::const_iterator it = lines.begin();
-  LineTable::const_iterator last = lines.begin();
-  while (it != lines.end() && it->GetAddress() <= address) {
-    last = it;
-    ++it;
-    continue;
+  AMX_DBG_LINE line;
+  if (lines_.Find(address, line)) {
+    return Line(line);
   }
-  line = *last;
-  return line;
+  return Line();
 }
 
 AMXDebugFile AMXDebugInfo::GetFile(cell address) const {
@@ -227,17 +316,69 @@ std::string AMXDebugInfo::GetTagName(int32_t tag_id) const {
   return name;
 }
 
+// Same as dbg_GetFunctionAddress() but uses the compact line table.
 cell AMXDebugInfo::GetFunctionAddress(const std::string &func,
                                const std::string &file) const {
-  ucell address;
-  dbg_GetFunctionAddress(amxdbg_, func.c_str(), file.c_str(), &address);
-  return static_cast<cell>(address);
+  ucell address = 0;
+  bool found = false;
+  for (int i = 0; i < amxdbg_->hdr->symbols; i++) {
+    const AMX_DBG_SYMBOL *symbol = amxdbg_->symboltbl[i];
+    if (symbol->ident != iFUNCTN || func != symbol->name) {
+      continue;
+    }
+    const char *filename;
+    if (dbg_LookupFile(amxdbg_, symbol->address, &filename) == AMX_ERR_NONE
+        && file == filename) {
+      address = symbol->address;
+      found = true;
+      break;
+    }
+  }
+  if (!found) {
+    return 0;
+  }
+
+  // The first line in the function where one can break.
+  std::vector<AMX_DBG_LINE> lines;
+  lines_.GetLines(lines);
+  for (std::size_t i = 0; i < lines.size(); i++) {
+    if (lines[i].address >= address) {
+      return static_cast<cell>(lines[i].address);
+    }
+  }
+  return 0;
 }
 
+// Same as dbg_GetLineAddress() but uses the compact line table.
 cell AMXDebugInfo::GetLineAddress(long line, const std::string &file) const {
-  ucell address;
-  dbg_GetLineAddress(amxdbg_, line, file.c_str(), &address);
-  return static_cast<cell>(address);
+  std::vector<AMX_DBG_LINE> lines;
+  lines_.GetLines(lines);
+
+  std::size_t index = 0;
+  for (int i = 0; i < amxdbg_->hdr->files; i++) {
+    if (file != amxdbg_->filetbl[i]->name) {
+      continue;
+    }
+    ucell bottom = amxdbg_->filetbl[i]->address;
+    ucell top = (i + 1 < amxdbg_->hdr->files)
+                ? amxdbg_->filetbl[i + 1]->address
+                : static_cast<ucell>(-1);
+    while (index < lines.size() && lines[index].address < bottom) {
+      index++;
+    }
+    while (index < lines.size()
+           && lines[index].line < line
+           && lines[index].address < top) {
+      index++;
+    }
+    if (index >= lines.size()) {
+      return 0;
+    }
+    if (lines[index].line >= line) {
+      return lines[index].address;
+    }
+  }
+  return 0;
 }
 
 // static
@@ -33,6 +33,8 @@
 #include <amx/amx.h>
 #include <amx/amxdbg.h>
 
+#include "amxlinetable.h"
+
 class AMXDebugInfo {
  public:
   template<typename EntryT, typename EntryClassT> class Table {
@@ -251,6 +253,13 @@ class AMXDebugInfo {
   bool IsLoaded() const;
   void Free();
 
+  // Exchanges the loaded debug info with another object.
+  void Swap(AMXDebugInfo &other);
+
+  // Updates code addresses after the cells at the given (sorted) addresses
+  // have been removed from the script's code, see AMXOptimizer::RemoveBreaks().
+  void RemoveCode(const std::vector<cell> &addresses);
+
   Line      GetLine(cell address) const;
   File      GetFile(cell address) const;
   Symbol    GetFunction(cell address) const;
@@ -273,10 +282,11 @@ class AMXDebugInfo {
     return FileTable(amxdbg_->filetbl, amxdbg_->hdr->files); 
   }
 
-  typedef Table<AMX_DBG_LINE, Line> LineTable;
+  // The line table is kept in a compact form, see AMXLineTable.
+  typedef AMXLineTable LineTable;
 
-  LineTable GetLines() const { 
-    return LineTable(amxdbg_->linetbl, amxdbg_->hdr->lines);
+  const LineTable &GetLines() const {
+    return lines_;
   }
 
   typedef Table<AMX_DBG_TAG*, Tag> TagTable;
@@ -313,6 +323,7 @@ class AMXDebugInfo {
 
  private:
   AMX_DBG *amxdbg_;
+  AMXLineTable lines_;
 };
 
 typedef AMXDebugInfo::File      AMXDebugFile;
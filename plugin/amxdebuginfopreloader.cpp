@@ -0,0 +1,102 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "amxdebuginfopreloader.h"
+#include "compiler.h"
+#include "fileutils.h"
+
+AMXDebugInfoPreloader::Entry::Entry(const std::string &filename)
+ : filename(filename),
+   mtime(0),
+   loaded(0),
+   taken(false)
+{
+}
+
+AMXDebugInfoPreloader::AMXDebugInfoPreloader() {
+}
+
+AMXDebugInfoPreloader::~AMXDebugInfoPreloader() {
+  Finish();
+}
+
+void AMXDebugInfoPreloader::Start(const std::vector<std::string> &filenames) {
+  Finish();
+
+  for (std::vector<std::string>::const_iterator iterator = filenames.begin();
+       iterator != filenames.end(); ++iterator) {
+    if (string_to_entry_.find(*iterator) == string_to_entry_.end()) {
+      Entry *entry = new Entry(*iterator);
+      entries_.push_back(entry);
+      string_to_entry_.insert(std::make_pair(*iterator, entry));
+    }
+  }
+
+  pool_.Run(LoadEntry, this, entries_.size());
+}
+
+bool AMXDebugInfoPreloader::Take(const std::string &filename,
+                                 AMXDebugInfo &debug_info) {
+  StringToEntryMap::iterator iterator = string_to_entry_.find(filename);
+  if (iterator == string_to_entry_.end()) {
+    return false;
+  }
+
+  Entry *entry = iterator->second;
+  if (entry->taken) {
+    return false;
+  }
+  if (!compiler::LoadAcquire(&entry->loaded)) {
+    pool_.Wait();
+  }
+  if (!entry->debug_info.IsLoaded() ||
+      fileutils::GetModificationTime(filename) != entry->mtime) {
+    return false;
+  }
+
+  debug_info.Free();
+  debug_info.Swap(entry->debug_info);
+  entry->taken = true;
+  return true;
+}
+
+void AMXDebugInfoPreloader::Finish() {
+  pool_.Wait();
+
+  for (std::vector<Entry*>::iterator iterator = entries_.begin();
+       iterator != entries_.end(); ++iterator) {
+    delete *iterator;
+  }
+  entries_.clear();
+  string_to_entry_.clear();
+}
+
+// static
+void AMXDebugInfoPreloader::LoadEntry(void *args, std::size_t index) {
+  AMXDebugInfoPreloader *preloader = static_cast<AMXDebugInfoPreloader*>(args);
+  Entry *entry = preloader->entries_[index];
+  entry->mtime = fileutils::GetModificationTime(entry->filename);
+  entry->debug_info.Load(entry->filename);
+  compiler::StoreRelease(&entry->loaded, 1);
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef AMXDEBUGINFOPRELOADER_H
+#define AMXDEBUGINFOPRELOADER_H
+
+#include <cstddef>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "amxdebuginfo.h"
+#include "threadpool.h"
+
+// AMXDebugInfoPreloader loads debug info from a list of files on background
+// threads, so that it's ready by the time the scripts are loaded.
+//
+// Each file's debug info is handed over to the main thread through a flag
+// that the loading thread sets when it's done (see compiler::StoreRelease),
+// so taking debug info that's already loaded doesn't need any locking. If it
+// isn't loaded yet, Take() waits for the threads to finish.
+class AMXDebugInfoPreloader {
+ public:
+  AMXDebugInfoPreloader();
+  ~AMXDebugInfoPreloader();
+
+  // Starts loading debug info from the given files.
+  void Start(const std::vector<std::string> &filenames);
+
+  // Moves the debug info loaded from the file to debug_info. Returns false
+  // if the file was not preloaded, has already been taken or has been
+  // modified since it was loaded.
+  bool Take(const std::string &filename, AMXDebugInfo &debug_info);
+
+  // Waits for the threads and frees the debug info that hasn't been taken.
+  void Finish();
+
+ private:
+  struct Entry {
+    Entry(const std::string &filename);
+
+    std::string filename;
+    std::time_t mtime;
+    AMXDebugInfo debug_info;
+    volatile int loaded;
+    bool taken;
+  };
+
+  static void LoadEntry(void *args, std::size_t index);
+
+ private:
+  AMXDebugInfoPreloader(const AMXDebugInfoPreloader &);
+  void operator=(const AMXDebugInfoPreloader &);
+
+ private:
+  ThreadPool pool_;
+  std::vector<Entry*> entries_;
+
+  typedef std::map<std::string, Entry*> StringToEntryMap;
+  StringToEntryMap string_to_entry_;
+};
+
+#endif // !AMXDEBUGINFOPRELOADER_H
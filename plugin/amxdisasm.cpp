@@ -0,0 +1,169 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstddef>
+
+#include "amxdisasm.h"
+
+AMXInstruction::AMXInstruction()
+ : address_(0),
+   opcode_(AMX_OP_NONE)
+{
+}
+
+const char *AMXInstruction::GetName() const {
+  const AMXOpcodeInfo *info = GetAmxOpcodeInfo(opcode_);
+  if (info != 0) {
+    return info->name;
+  }
+  return 0;
+}
+
+bool AMXInstruction::IsCodeAddressOperand(int index) const {
+  if (opcode_ == AMX_OP_CASETBL) {
+    // casetbl <num> <default> [<value> <address>]...
+    return index % 2 != 0;
+  }
+  const AMXOpcodeInfo *info = GetAmxOpcodeInfo(opcode_);
+  return info != 0 && info->is_jump && index == 0;
+}
+
+AMXDisassembler::AMXDisassembler(AMXScript amx)
+ : amx_(amx),
+   ip_(0)
+{
+}
+
+bool AMXDisassembler::Decode(AMXInstruction &instr, bool *error) {
+  if (error != 0) {
+    *error = false;
+  }
+
+  const AMX_HEADER *hdr = amx_.GetHeader();
+  const unsigned char *code = amx_.GetCode();
+  cell code_size = hdr->dat - hdr->cod;
+
+  if (ip_ < 0 || ip_ >= code_size) {
+    return false;
+  }
+
+  bool relocated = (amx_.GetFlags() & AMX_FLAG_RELOC) != 0;
+  const cell *cip = reinterpret_cast<const cell*>(code + ip_);
+  const cell *end = reinterpret_cast<const cell*>(code + code_size);
+
+  AMXOpcode opcode;
+  if (relocated) {
+    opcode = UnrelocateAmxOpcode(*cip);
+  } else if (*cip > 0 && *cip < NUM_AMX_OPCODES) {
+    opcode = static_cast<AMXOpcode>(*cip);
+  } else {
+    opcode = AMX_OP_NONE;
+  }
+
+  const AMXOpcodeInfo *info = GetAmxOpcodeInfo(opcode);
+  if (opcode == AMX_OP_NONE || info == 0) {
+    if (error != 0) {
+      *error = true;
+    }
+    return false;
+  }
+
+  instr.set_address(ip_);
+  instr.set_opcode(opcode);
+  instr.operands().clear();
+  cip++;
+
+  int num_operands = info->num_operands;
+  if (num_operands == AMX_OPERANDS_VARIABLE) {
+    if (cip >= end) {
+      if (error != 0) {
+        *error = true;
+      }
+      return false;
+    }
+    switch (opcode) {
+      case AMX_OP_FILE:
+      case AMX_OP_SYMBOL:
+        // The first operand is the size of the rest in bytes.
+        num_operands = 1 + *cip / sizeof(cell);
+        break;
+      case AMX_OP_CASETBL:
+        num_operands = 2 * (*cip + 1);
+        break;
+      default:
+        num_operands = 0;
+        break;
+    }
+  }
+
+  if (num_operands < 0 || end - cip < num_operands) {
+    if (error != 0) {
+      *error = true;
+    }
+    return false;
+  }
+
+  for (int i = 0; i < num_operands; i++) {
+    cell operand = cip[i];
+    if (relocated && instr.IsCodeAddressOperand(i)) {
+      operand -= reinterpret_cast<cell>(code);
+    }
+    instr.operands().push_back(operand);
+  }
+
+  ip_ += instr.size();
+  return true;
+}
+
+namespace {
+
+const uint32_t kFnvOffsetBasis = 2166136261u;
+const uint32_t kFnvPrime = 16777619u;
+
+inline uint32_t HashCell(uint32_t hash, cell value) {
+  const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&value);
+  for (std::size_t i = 0; i < sizeof(cell); i++) {
+    hash ^= bytes[i];
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+} // anonymous namespace
+
+uint32_t GetAmxFingerprint(AMXScript amx) {
+  uint32_t hash = kFnvOffsetBasis;
+
+  AMXDisassembler disas(amx);
+  AMXInstruction instr;
+
+  while (disas.Decode(instr)) {
+    hash = HashCell(hash, instr.opcode());
+    for (int i = 0; i < instr.num_operands(); i++) {
+      hash = HashCell(hash, instr.operand(i));
+    }
+  }
+
+  return hash;
+}
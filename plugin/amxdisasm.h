@@ -0,0 +1,92 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef AMXDISASM_H
+#define AMXDISASM_H
+
+#include <vector>
+
+#include <amx/amx.h>
+
+#include "amxopcode.h"
+#include "amxscript.h"
+
+class AMXInstruction {
+ public:
+  AMXInstruction();
+
+  cell address() const { return address_; }
+  void set_address(cell address) { address_ = address; }
+
+  AMXOpcode opcode() const { return opcode_; }
+  void set_opcode(AMXOpcode opcode) { opcode_ = opcode; }
+
+  const std::vector<cell> &operands() const { return operands_; }
+  std::vector<cell> &operands() { return operands_; }
+
+  int num_operands() const { return static_cast<int>(operands_.size()); }
+  cell operand(int index = 0) const { return operands_[index]; }
+
+  // Size of the instruction in bytes, including the opcode.
+  cell size() const {
+    return static_cast<cell>((operands_.size() + 1) * sizeof(cell));
+  }
+
+  const char *GetName() const;
+
+  // Returns true if the operand at the given index is a code address.
+  bool IsCodeAddressOperand(int index) const;
+
+ private:
+  cell address_;
+  AMXOpcode opcode_;
+  std::vector<cell> operands_;
+};
+
+// Decodes instructions of a loaded script. Opcodes are mapped back to their
+// numbers and code address operands (jump targets, case tables, etc) are made
+// relative to the start of the code section, so the result does not depend
+// on where the script has been loaded.
+class AMXDisassembler {
+ public:
+  explicit AMXDisassembler(AMXScript amx);
+
+  cell ip() const { return ip_; }
+  void set_ip(cell ip) { ip_ = ip; }
+
+  // Decodes the instruction at ip() and advances ip() past it. Returns false
+  // on the end of code or an invalid instruction.
+  bool Decode(AMXInstruction &instr, bool *error = 0);
+
+ private:
+  AMXScript amx_;
+  cell ip_;
+};
+
+// Computes a 32-bit FNV-1a hash of the script's code. Instructions are
+// hashed in their position-independent form (see AMXDisassembler) so that
+// a loaded script and the same .amx file on disk produce the same value.
+uint32_t GetAmxFingerprint(AMXScript amx);
+
+#endif // !AMXDISASM_H
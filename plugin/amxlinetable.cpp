@@ -0,0 +1,171 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+
+#include "amxlinetable.h"
+
+namespace {
+
+void WriteVarint(std::vector<unsigned char> &data, uint32_t value) {
+  while (value >= 0x80) {
+    data.push_back(static_cast<unsigned char>(value | 0x80));
+    value >>= 7;
+  }
+  data.push_back(static_cast<unsigned char>(value));
+}
+
+inline uint32_t ReadVarint(const unsigned char *&ptr) {
+  uint32_t value = *ptr & 0x7F;
+  for (int shift = 7; *ptr++ & 0x80; shift += 7) {
+    value |= static_cast<uint32_t>(*ptr & 0x7F) << shift;
+  }
+  return value;
+}
+
+// Line numbers may go backwards, e.g. in loops; zigzag encoding keeps small
+// negative deltas small.
+inline uint32_t EncodeZigzag(int32_t value) {
+  return (static_cast<uint32_t>(value) << 1)
+       ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t DecodeZigzag(uint32_t value) {
+  return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+} // anonymous namespace
+
+const int AMXLineTable::kBlockSize;
+
+AMXLineTable::AMXLineTable()
+ : size_(0)
+{
+}
+
+void AMXLineTable::Build(const AMX_DBG_LINE *lines, int num_lines) {
+  Clear();
+
+  for (int i = 0; i < num_lines; i++) {
+    if (i % kBlockSize == 0) {
+      Block block;
+      block.address = lines[i].address;
+      block.line = lines[i].line;
+      block.offset = static_cast<uint32_t>(data_.size());
+      blocks_.push_back(block);
+    } else {
+      WriteVarint(data_, lines[i].address - lines[i - 1].address);
+      WriteVarint(data_, EncodeZigzag(lines[i].line - lines[i - 1].line));
+    }
+  }
+  size_ = num_lines;
+
+  std::vector<Block>(blocks_).swap(blocks_);
+  std::vector<unsigned char>(data_).swap(data_);
+}
+
+void AMXLineTable::Clear() {
+  std::vector<Block>().swap(blocks_);
+  std::vector<unsigned char>().swap(data_);
+  size_ = 0;
+}
+
+void AMXLineTable::Swap(AMXLineTable &other) {
+  blocks_.swap(other.blocks_);
+  data_.swap(other.data_);
+  std::swap(size_, other.size_);
+}
+
+AMX_DBG_LINE AMXLineTable::operator[](int index) const {
+  return Decode(index / kBlockSize, index % kBlockSize + 1,
+                static_cast<ucell>(-1));
+}
+
+bool AMXLineTable::Find(cell address, AMX_DBG_LINE &line) const {
+  if (size_ == 0) {
+    return false;
+  }
+
+  // Find the last block that starts at or before the address.
+  int lo = 0;
+  int hi = static_cast<int>(blocks_.size());
+  while (hi - lo > 1) {
+    int mid = lo + (hi - lo) / 2;
+    if (blocks_[mid].address <= static_cast<ucell>(address)) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+
+  line = Decode(lo, kBlockSize, static_cast<ucell>(address));
+  return true;
+}
+
+void AMXLineTable::GetLines(std::vector<AMX_DBG_LINE> &lines) const {
+  lines.clear();
+  lines.reserve(size_);
+  for (std::size_t i = 0; i < blocks_.size(); i++) {
+    AMX_DBG_LINE line;
+    line.address = blocks_[i].address;
+    line.line = blocks_[i].line;
+    lines.push_back(line);
+    int num_entries = std::min(kBlockSize,
+                               size_ - static_cast<int>(i) * kBlockSize);
+    if (num_entries > 1) {
+      const unsigned char *ptr = &data_[blocks_[i].offset];
+      for (int j = 1; j < num_entries; j++) {
+        line.address += ReadVarint(ptr);
+        line.line += DecodeZigzag(ReadVarint(ptr));
+        lines.push_back(line);
+      }
+    }
+  }
+}
+
+std::size_t AMXLineTable::GetMemoryUsage() const {
+  return blocks_.capacity() * sizeof(Block) + data_.capacity();
+}
+
+AMX_DBG_LINE AMXLineTable::Decode(int block, int count,
+                                  ucell max_address) const {
+  const Block &b = blocks_[block];
+  AMX_DBG_LINE line;
+  line.address = b.address;
+  line.line = b.line;
+
+  int num_entries = std::min(count, size_ - block * kBlockSize);
+  if (num_entries > 1) {
+    const unsigned char *ptr = &data_[b.offset];
+    for (int i = 1; i < num_entries; i++) {
+      ucell address = line.address + ReadVarint(ptr);
+      if (address > max_address) {
+        break;
+      }
+      line.address = address;
+      line.line += DecodeZigzag(ReadVarint(ptr));
+    }
+  }
+  return line;
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef AMXLINETABLE_H
+#define AMXLINETABLE_H
+
+#include <cstddef>
+#include <vector>
+
+#include <amx/amx.h>
+#include <amx/amxdbg.h>
+
+// A compact copy of the line table from a script's debug info. Entries are
+// grouped into blocks of kBlockSize; the first entry of each block is kept
+// as is and the others are stored as variable-length deltas from the entry
+// before them, which usually takes two bytes instead of eight. Lookups
+// binary search the blocks and decode only one of them.
+//
+// The entries must be sorted by address, which is always the case for line
+// tables generated by the Pawn compiler.
+class AMXLineTable {
+ public:
+  static const int kBlockSize = 32;
+
+  AMXLineTable();
+
+  void Build(const AMX_DBG_LINE *lines, int num_lines);
+  void Clear();
+  void Swap(AMXLineTable &other);
+
+  int size() const { return size_; }
+
+  // Returns the entry at the given index.
+  AMX_DBG_LINE operator[](int index) const;
+
+  // Finds the last entry whose address is not greater than the given one,
+  // or the first entry if there is no such entry. Returns false if the
+  // table is empty.
+  bool Find(cell address, AMX_DBG_LINE &line) const;
+
+  // Decodes the whole table.
+  void GetLines(std::vector<AMX_DBG_LINE> &lines) const;
+
+  // Number of bytes used by the table (not counting the object itself).
+  std::size_t GetMemoryUsage() const;
+
+ private:
+  struct Block {
+    ucell address;
+    int32_t line;
+    uint32_t offset; // in data_
+  };
+
+  // Decodes up to count entries of the block, stopping at the first one
+  // whose address is greater than max_address. Returns the last decoded
+  // entry.
+  AMX_DBG_LINE Decode(int block, int count, ucell max_address) const;
+
+ private:
+  std::vector<Block> blocks_;
+  std::vector<unsigned char> data_;
+  int size_;
+};
+
+#endif // !AMXLINETABLE_H
@@ -0,0 +1,155 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstring>
+#include <map>
+
+#include "amxnativelist.h"
+#include "amxscript.h"
+
+namespace {
+
+// Lists shorter than this are not worth indexing, and they include the
+// one-element lists from amx_RegisterFunc() which reuse the same pointer
+// for every function.
+const int kMinIndexedCount = 16;
+
+typedef std::map<const AMX_NATIVE_INFO*, AMXNativeList> IndexCache;
+IndexCache index_cache;
+
+AMX_NATIVE FindLinear(const AMX_NATIVE_INFO *natives, int count,
+                      const char *name) {
+  for (int i = 0; i < count; i++) {
+    if (std::strcmp(natives[i].name, name) == 0) {
+      return natives[i].func;
+    }
+  }
+  return 0;
+}
+
+} // anonymous namespace
+
+AMXNativeList::AMXNativeList()
+ : natives_(0),
+   count_(0),
+   signature_(0)
+{
+}
+
+AMXNativeList::AMXNativeList(const AMX_NATIVE_INFO *natives, int number)
+ : natives_(natives),
+   count_(GetCount(natives, number)),
+   signature_(GetSignature(natives, count_))
+{
+  for (int i = 0; i < count_; i++) {
+    names_.Insert(natives[i].name, i);
+  }
+}
+
+AMX_NATIVE AMXNativeList::Find(const char *name) const {
+  int index = names_.Find(name);
+  if (index >= 0) {
+    return natives_[index].func;
+  }
+  return 0;
+}
+
+// static
+int AMXNativeList::Register(AMX *amx, const AMX_NATIVE_INFO *natives,
+                            int number) {
+  AMXScript script(amx);
+  const AMX_HEADER *hdr = script.GetHeader();
+  if (hdr->defsize != sizeof(AMX_FUNCSTUBNT)) {
+    return amx_Register(amx, natives, number);
+  }
+
+  const AMXNativeList *index = 0;
+  int count = 0;
+  if (natives != 0) {
+    count = GetCount(natives, number);
+    if (count >= kMinIndexedCount) {
+      // The same pointer may be reused for a different list (e.g. after a
+      // plugin is unloaded) and the names may be changed in place, so check
+      // that the names are still the same.
+      IndexCache::iterator it = index_cache.find(natives);
+      if (it == index_cache.end()
+          || it->second.count_ != count
+          || it->second.signature_ != GetSignature(natives, count)) {
+        index_cache[natives] = AMXNativeList(natives, number);
+        it = index_cache.find(natives);
+      }
+      index = &it->second;
+    }
+  }
+
+  int error = AMX_ERR_NONE;
+  AMX_FUNCSTUBNT *stubs = script.GetNatives();
+  int num_natives = script.GetNumNatives();
+
+  for (int i = 0; i < num_natives; i++) {
+    if (stubs[i].address != 0) {
+      continue;
+    }
+    const char *name = script.GetName(stubs[i].nameofs);
+    AMX_NATIVE func = 0;
+    if (index != 0) {
+      func = index->Find(name);
+    } else if (natives != 0) {
+      func = FindLinear(natives, count, name);
+    }
+    if (func != 0) {
+      stubs[i].address = reinterpret_cast<ucell>(func);
+    } else {
+      error = AMX_ERR_NOTFOUND;
+    }
+  }
+
+  if (error == AMX_ERR_NONE) {
+    script.SetFlags(script.GetFlags() | AMX_FLAG_NTVREG);
+  }
+  return error;
+}
+
+// static
+int AMXNativeList::GetCount(const AMX_NATIVE_INFO *natives, int number) {
+  // Same as the loop in findfunction() in amx.c.
+  int count = 0;
+  while (natives[count].name != 0 && (count < number || number == -1)) {
+    count++;
+  }
+  return count;
+}
+
+// static
+std::size_t AMXNativeList::GetSignature(const AMX_NATIVE_INFO *natives,
+                                        int count) {
+  // The index refers to the names by pointer, so both the pointers and
+  // the names they point to must stay the same.
+  std::size_t signature = 0;
+  for (int i = 0; i < count; i++) {
+    signature = signature * 31 + reinterpret_cast<std::size_t>(natives[i].name);
+    signature = signature * 31 + NameTable::Hash(natives[i].name);
+  }
+  return signature;
+}
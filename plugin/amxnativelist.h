@@ -0,0 +1,60 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef AMXNATIVELIST_H
+#define AMXNATIVELIST_H
+
+#include <cstddef>
+
+#include <amx/amx.h>
+
+#include "nametable.h"
+
+// A hash index of a native function list as passed to amx_Register().
+class AMXNativeList {
+ public:
+  AMXNativeList();
+  AMXNativeList(const AMX_NATIVE_INFO *natives, int number);
+
+  // Returns the function with the given name, or 0 if there is none. If
+  // there are several, the first one wins, like in amx_Register().
+  AMX_NATIVE Find(const char *name) const;
+
+  // Works like amx_Register(). Long lists are indexed the first time they
+  // are seen and the index is reused for as long as the list stays the
+  // same, shorter lists are searched linearly.
+  static int Register(AMX *amx, const AMX_NATIVE_INFO *natives, int number);
+
+ private:
+  static int GetCount(const AMX_NATIVE_INFO *natives, int number);
+  static std::size_t GetSignature(const AMX_NATIVE_INFO *natives, int count);
+
+ private:
+  const AMX_NATIVE_INFO *natives_;
+  int count_;
+  std::size_t signature_;
+  NameTable names_; // name -> index into natives_
+};
+
+#endif // !AMXNATIVELIST_H
@@ -22,8 +22,199 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
+#include <utility>
+#include <vector>
 #include "amxopcode.h"
 
+static const AMXOpcodeInfo opcode_info[NUM_AMX_OPCODES] = {
+  {"none", 0, false},
+  {"load.pri", 1, false},
+  {"load.alt", 1, false},
+  {"load.s.pri", 1, false},
+  {"load.s.alt", 1, false},
+  {"lref.pri", 1, false},
+  {"lref.alt", 1, false},
+  {"lref.s.pri", 1, false},
+  {"lref.s.alt", 1, false},
+  {"load.i", 0, false},
+  {"lodb.i", 1, false},
+  {"const.pri", 1, false},
+  {"const.alt", 1, false},
+  {"addr.pri", 1, false},
+  {"addr.alt", 1, false},
+  {"stor.pri", 1, false},
+  {"stor.alt", 1, false},
+  {"stor.s.pri", 1, false},
+  {"stor.s.alt", 1, false},
+  {"sref.pri", 1, false},
+  {"sref.alt", 1, false},
+  {"sref.s.pri", 1, false},
+  {"sref.s.alt", 1, false},
+  {"stor.i", 0, false},
+  {"strb.i", 1, false},
+  {"lidx", 0, false},
+  {"lidx.b", 1, false},
+  {"idxaddr", 0, false},
+  {"idxaddr.b", 1, false},
+  {"align.pri", 1, false},
+  {"align.alt", 1, false},
+  {"lctrl", 1, false},
+  {"sctrl", 1, false},
+  {"move.pri", 0, false},
+  {"move.alt", 0, false},
+  {"xchg", 0, false},
+  {"push.pri", 0, false},
+  {"push.alt", 0, false},
+  {"push.r", 1, false},
+  {"push.c", 1, false},
+  {"push", 1, false},
+  {"push.s", 1, false},
+  {"pop.pri", 0, false},
+  {"pop.alt", 0, false},
+  {"stack", 1, false},
+  {"heap", 1, false},
+  {"proc", 0, false},
+  {"ret", 0, false},
+  {"retn", 0, false},
+  {"call", 1, true},
+  {"call.pri", 0, false},
+  {"jump", 1, true},
+  {"jrel", 1, false},
+  {"jzer", 1, true},
+  {"jnz", 1, true},
+  {"jeq", 1, true},
+  {"jneq", 1, true},
+  {"jless", 1, true},
+  {"jleq", 1, true},
+  {"jgrtr", 1, true},
+  {"jgeq", 1, true},
+  {"jsless", 1, true},
+  {"jsleq", 1, true},
+  {"jsgrtr", 1, true},
+  {"jsgeq", 1, true},
+  {"shl", 0, false},
+  {"shr", 0, false},
+  {"sshr", 0, false},
+  {"shl.c.pri", 1, false},
+  {"shl.c.alt", 1, false},
+  {"shr.c.pri", 1, false},
+  {"shr.c.alt", 1, false},
+  {"smul", 0, false},
+  {"sdiv", 0, false},
+  {"sdiv.alt", 0, false},
+  {"umul", 0, false},
+  {"udiv", 0, false},
+  {"udiv.alt", 0, false},
+  {"add", 0, false},
+  {"sub", 0, false},
+  {"sub.alt", 0, false},
+  {"and", 0, false},
+  {"or", 0, false},
+  {"xor", 0, false},
+  {"not", 0, false},
+  {"neg", 0, false},
+  {"invert", 0, false},
+  {"add.c", 1, false},
+  {"smul.c", 1, false},
+  {"zero.pri", 0, false},
+  {"zero.alt", 0, false},
+  {"zero", 1, false},
+  {"zero.s", 1, false},
+  {"sign.pri", 0, false},
+  {"sign.alt", 0, false},
+  {"eq", 0, false},
+  {"neq", 0, false},
+  {"less", 0, false},
+  {"leq", 0, false},
+  {"grtr", 0, false},
+  {"geq", 0, false},
+  {"sless", 0, false},
+  {"sleq", 0, false},
+  {"sgrtr", 0, false},
+  {"sgeq", 0, false},
+  {"eq.c.pri", 1, false},
+  {"eq.c.alt", 1, false},
+  {"inc.pri", 0, false},
+  {"inc.alt", 0, false},
+  {"inc", 1, false},
+  {"inc.s", 1, false},
+  {"inc.i", 0, false},
+  {"dec.pri", 0, false},
+  {"dec.alt", 0, false},
+  {"dec", 1, false},
+  {"dec.s", 1, false},
+  {"dec.i", 0, false},
+  {"movs", 1, false},
+  {"cmps", 1, false},
+  {"fill", 1, false},
+  {"halt", 1, false},
+  {"bounds", 1, false},
+  {"sysreq.pri", 0, false},
+  {"sysreq.c", 1, false},
+  {"file", AMX_OPERANDS_VARIABLE, false},
+  {"line", 2, false},
+  {"symbol", AMX_OPERANDS_VARIABLE, false},
+  {"srange", 2, false},
+  {"jump.pri", 0, false},
+  {"switch", 1, true},
+  {"casetbl", AMX_OPERANDS_VARIABLE, false},
+  {"swap.pri", 0, false},
+  {"swap.alt", 0, false},
+  {"push.adr", 1, false},
+  {"nop", 0, false},
+  {"sysreq.d", 1, false},
+  {"symtag", 1, false},
+  {"break", 0, false},
+};
+
+static const AMXSuperinstruction superinstructions[] = {
+  {AMX_OP_PUSH_PRI_PUSH_C,       AMX_OP_PUSH_PRI,   AMX_OP_PUSH_C},
+  {AMX_OP_CONST_PRI_PUSH_PRI,    AMX_OP_CONST_PRI,  AMX_OP_PUSH_PRI},
+  {AMX_OP_LOAD_S_PRI_PUSH_PRI,   AMX_OP_LOAD_S_PRI, AMX_OP_PUSH_PRI},
+  {AMX_OP_ADDR_PRI_PUSH_PRI,     AMX_OP_ADDR_PRI,   AMX_OP_PUSH_PRI},
+  {AMX_OP_PUSH_C_SYSREQ_C,       AMX_OP_PUSH_C,     AMX_OP_SYSREQ_C},
+  {AMX_OP_PUSH_C_CALL,           AMX_OP_PUSH_C,     AMX_OP_CALL},
+  {AMX_OP_ZERO_PRI_RETN,         AMX_OP_ZERO_PRI,   AMX_OP_RETN},
+  {AMX_OP_PUSH_C_SYSREQ_N,       AMX_OP_PUSH_C,     AMX_OP_SYSREQ_N},
+  {AMX_OP_LOAD_S_ALT_LOAD_S_PRI, AMX_OP_LOAD_S_ALT, AMX_OP_LOAD_S_PRI},
+  {AMX_OP_LOAD_S_PRI_CONST_ALT,  AMX_OP_LOAD_S_PRI, AMX_OP_CONST_ALT},
+  {AMX_OP_LOAD_S_PRI_ADD_C,      AMX_OP_LOAD_S_PRI, AMX_OP_ADD_C},
+  {AMX_OP_LOAD_S_PRI_BOUNDS,     AMX_OP_LOAD_S_PRI, AMX_OP_BOUNDS},
+  {AMX_OP_ADD_STOR_S_PRI,        AMX_OP_ADD,        AMX_OP_STOR_S_PRI},
+  {AMX_OP_INC_S_JUMP,            AMX_OP_INC_S,      AMX_OP_JUMP},
+  {AMX_OP_LOAD_S_PRI_BOUNDS_NOP, AMX_OP_LOAD_S_PRI, AMX_OP_BOUNDS_NOP}
+};
+
+static const int num_superinstructions =
+  sizeof(superinstructions) / sizeof(superinstructions[0]);
+
+const AMXSuperinstruction *FindAmxSuperinstruction(AMXOpcode first,
+                                                   AMXOpcode second) {
+  for (int i = 0; i < num_superinstructions; i++) {
+    if (superinstructions[i].first == first &&
+        superinstructions[i].second == second) {
+      return &superinstructions[i];
+    }
+  }
+  return 0;
+}
+
+bool AmxHasInternalOpcodes() {
+  #if defined __GNUC__ && !defined __MINGW32__
+    return true;
+  #else
+    return false;
+  #endif
+}
+
+const AMXOpcodeInfo *GetAmxOpcodeInfo(AMXOpcode opcode) {
+  if (opcode >= 0 && opcode < NUM_AMX_OPCODES) {
+    return &opcode_info[opcode];
+  }
+  return 0;
+}
+
 static cell *GetOpcodeMap() {
   #if defined __GNUC__
     cell *opcode_map;
@@ -40,10 +231,63 @@ static cell *GetOpcodeMap() {
 cell RelocateAmxOpcode(cell opcode) {
   #if defined __GNUC__
     static cell *opcode_map = GetOpcodeMap();
-    if (opcode >= 0 && opcode < NUM_AMX_OPCODES) {
+    if (opcode >= 0 && opcode < AMX_OP_INTERNAL_LAST_) {
       return opcode_map[opcode];
     }
   #endif
   return opcode;
 }
 
+
+#if defined __GNUC__
+
+typedef std::vector<std::pair<cell, cell> > OpcodeIndex;
+
+// Other internal opcodes and the ones they replace.
+static const AMXOpcode variants[][2] = {
+  {AMX_OP_SYSREQ_N,    AMX_OP_SYSREQ_C},
+  {AMX_OP_STACK_ALLOC, AMX_OP_STACK},
+  {AMX_OP_STACK_FREE,  AMX_OP_STACK},
+  {AMX_OP_HEAP_ALLOC,  AMX_OP_HEAP},
+  {AMX_OP_HEAP_FREE,   AMX_OP_HEAP},
+  {AMX_OP_BOUNDS_NOP,  AMX_OP_BOUNDS}
+};
+
+static const int num_variants = sizeof(variants) / sizeof(variants[0]);
+
+static OpcodeIndex GetOpcodeIndex() {
+  OpcodeIndex index;
+  for (cell i = 0; i < NUM_AMX_OPCODES; i++) {
+    index.push_back(std::make_pair(RelocateAmxOpcode(i), i));
+  }
+  for (int i = 0; i < num_superinstructions; i++) {
+    const AMXSuperinstruction &super = superinstructions[i];
+    index.push_back(std::make_pair(RelocateAmxOpcode(super.opcode),
+                                   static_cast<cell>(super.first)));
+  }
+  for (int i = 0; i < num_variants; i++) {
+    index.push_back(std::make_pair(RelocateAmxOpcode(variants[i][0]),
+                                   static_cast<cell>(variants[i][1])));
+  }
+  std::sort(index.begin(), index.end());
+  return index;
+}
+
+#endif
+
+AMXOpcode UnrelocateAmxOpcode(cell opcode) {
+  #if defined __GNUC__
+    static OpcodeIndex index = GetOpcodeIndex();
+    OpcodeIndex::const_iterator it = std::lower_bound(index.begin(),
+      index.end(), std::make_pair(opcode, static_cast<cell>(0)));
+    if (it != index.end() && it->first == opcode) {
+      return static_cast<AMXOpcode>(it->second);
+    }
+    return AMX_OP_NONE;
+  #else
+    if (opcode >= 0 && opcode < NUM_AMX_OPCODES) {
+      return static_cast<AMXOpcode>(opcode);
+    }
+    return AMX_OP_NONE;
+  #endif
+}
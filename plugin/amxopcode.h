@@ -74,11 +74,69 @@ enum AMXOpcode {
   AMX_OP_SWITCH,       AMX_OP_CASETBL,      AMX_OP_SWAP_PRI,
   AMX_OP_SWAP_ALT,     AMX_OP_PUSH_ADR,     AMX_OP_NOP,
   AMX_OP_SYSREQ_D,     AMX_OP_SYMTAG,       AMX_OP_BREAK,
-  AMX_OP_LAST_
+  AMX_OP_LAST_,
+
+  // Internal opcodes, must be in sync with amx.c. These are never found in
+  // .amx files, see AMXOptimizer.
+  AMX_OP_PUSH_PRI_PUSH_C = AMX_OP_LAST_,
+  AMX_OP_CONST_PRI_PUSH_PRI,
+  AMX_OP_LOAD_S_PRI_PUSH_PRI,
+  AMX_OP_ADDR_PRI_PUSH_PRI,
+  AMX_OP_PUSH_C_SYSREQ_C,
+  AMX_OP_PUSH_C_CALL,
+  AMX_OP_ZERO_PRI_RETN,
+  AMX_OP_SYSREQ_N,
+  AMX_OP_PUSH_C_SYSREQ_N,
+  AMX_OP_LOAD_S_ALT_LOAD_S_PRI,
+  AMX_OP_LOAD_S_PRI_CONST_ALT,
+  AMX_OP_LOAD_S_PRI_ADD_C,
+  AMX_OP_LOAD_S_PRI_BOUNDS,
+  AMX_OP_ADD_STOR_S_PRI,
+  AMX_OP_INC_S_JUMP,
+  AMX_OP_STACK_ALLOC,
+  AMX_OP_STACK_FREE,
+  AMX_OP_HEAP_ALLOC,
+  AMX_OP_HEAP_FREE,
+  AMX_OP_BOUNDS_NOP,
+  AMX_OP_LOAD_S_PRI_BOUNDS_NOP,
+  AMX_OP_INTERNAL_LAST_
 };
 
 const int NUM_AMX_OPCODES = AMX_OP_LAST_;
 
+struct AMXSuperinstruction {
+  AMXOpcode opcode;
+  AMXOpcode first;
+  AMXOpcode second;
+};
+
+// Returns the superinstruction that can replace the given pair of opcodes
+// or 0 if there's none.
+const AMXSuperinstruction *FindAmxSuperinstruction(AMXOpcode first,
+                                                   AMXOpcode second);
+
+// Returns true if the bundled amx_Exec() supports internal opcodes
+// (superinstructions and SYSREQ_N).
+bool AmxHasInternalOpcodes();
+
+// Number of operands of an opcode whose operand count varies (FILE, SYMBOL
+// and CASETBL).
+const int AMX_OPERANDS_VARIABLE = -1;
+
+struct AMXOpcodeInfo {
+  const char *name;
+  int num_operands;
+  bool is_jump; // the operand is a (relocated) code address
+};
+
+const AMXOpcodeInfo *GetAmxOpcodeInfo(AMXOpcode opcode);
+
 cell RelocateAmxOpcode(cell opcode);
 
+// The reverse of RelocateAmxOpcode(): maps a relocated opcode (as seen in
+// the code of a loaded script) back to its number. Superinstructions are
+// mapped to their first opcode and other internal opcodes to the ones they
+// replace. Returns AMX_OP_NONE for unknown opcodes.
+AMXOpcode UnrelocateAmxOpcode(cell opcode);
+
 #endif // !AMXOPCODE_H
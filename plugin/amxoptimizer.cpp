@@ -0,0 +1,268 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <vector>
+
+#include "amxdisasm.h"
+#include "amxoptimizer.h"
+#include "amxverifier.h"
+
+namespace {
+
+// Returns the new address of an instruction after the given cells have been
+// removed from the code before it.
+cell MapAddress(const std::vector<cell> &removed, cell address) {
+  std::vector<cell>::const_iterator it =
+    std::lower_bound(removed.begin(), removed.end(), address);
+  return address - static_cast<cell>(it - removed.begin()) * sizeof(cell);
+}
+
+} // anonymous namespace
+
+AMXOptimizer::AMXOptimizer(AMXScript amx)
+ : amx_(amx)
+{
+}
+
+void AMXOptimizer::SortCaseTables() {
+  AMXDisassembler disas(amx_);
+  AMXInstruction instr;
+
+  while (disas.Decode(instr)) {
+    if (instr.opcode() == AMX_OP_CASETBL) {
+      cell *casetbl = reinterpret_cast<cell*>(amx_.GetCode()
+                                              + instr.address()) + 1;
+      amx_SortCaseTable(casetbl);
+    }
+  }
+}
+
+int AMXOptimizer::RemoveBreaks(std::vector<cell> &breaks) {
+  AMXDisassembler disas(amx_);
+  AMXInstruction instr;
+  std::vector<AMXInstruction> instrs;
+  bool error = false;
+
+  breaks.clear();
+
+  while (disas.Decode(instr, &error)) {
+    bool dynamic = false;
+    switch (instr.opcode()) {
+      case AMX_OP_BREAK:
+        breaks.push_back(instr.address());
+        break;
+      case AMX_OP_CALL_PRI:
+      case AMX_OP_JUMP_PRI:
+      case AMX_OP_JREL:
+        dynamic = true;
+        break;
+      case AMX_OP_LCTRL:
+        dynamic = instr.operand() == 0  // COD
+               || instr.operand() == 1  // DAT
+               || instr.operand() == 6; // CIP
+        break;
+      case AMX_OP_SCTRL:
+        dynamic = instr.operand() == 6;
+        break;
+      default:
+        break;
+    }
+    if (dynamic) {
+      breaks.clear();
+      return 0;
+    }
+    instrs.push_back(instr);
+  }
+  if (error) {
+    breaks.clear();
+    return 0;
+  }
+  if (breaks.empty()) {
+    return 0;
+  }
+
+  // Instructions only move back, so the code can be compacted in place.
+  unsigned char *code = amx_.GetCode();
+  cell new_address = 0;
+
+  for (std::vector<AMXInstruction>::const_iterator it = instrs.begin();
+       it != instrs.end(); it++) {
+    if (it->opcode() == AMX_OP_BREAK) {
+      continue;
+    }
+    cell *src = reinterpret_cast<cell*>(code + it->address());
+    cell *dst = reinterpret_cast<cell*>(code + new_address);
+    dst[0] = src[0];
+    for (int i = 0; i < it->num_operands(); i++) {
+      cell operand = src[i + 1];
+      if (it->IsCodeAddressOperand(i)) {
+        // Works the same for relocated (absolute) and relative addresses.
+        cell target = it->operand(i);
+        operand -= target - MapAddress(breaks, target);
+      }
+      dst[i + 1] = operand;
+    }
+    new_address += it->size();
+  }
+
+  const AMX_HEADER *hdr = amx_.GetHeader();
+  cell code_size = hdr->dat - hdr->cod;
+  cell nop = AMX_OP_NOP;
+  if ((amx_.GetFlags() & AMX_FLAG_RELOC) != 0) {
+    nop = RelocateAmxOpcode(AMX_OP_NOP);
+  }
+  for (; new_address < code_size; new_address += sizeof(cell)) {
+    *reinterpret_cast<cell*>(code + new_address) = nop;
+  }
+
+  AMX_FUNCSTUBNT *publics = amx_.GetPublics();
+  for (int i = 0; i < amx_.GetNumPublics(); i++) {
+    publics[i].address = MapAddress(breaks, publics[i].address);
+  }
+  if (hdr->cip >= 0) {
+    amx_.GetHeader()->cip = MapAddress(breaks, hdr->cip);
+  }
+  amx_.SetCip(MapAddress(breaks, amx_.GetCip()));
+
+  return static_cast<int>(breaks.size());
+}
+
+int AMXOptimizer::FuseInstructions() {
+  if (!AmxHasInternalOpcodes()) {
+    return 0;
+  }
+
+  AMXDisassembler disas(amx_);
+  AMXInstruction prev_instr;
+  AMXInstruction instr;
+  int count = 0;
+
+  if (!disas.Decode(prev_instr)) {
+    return 0;
+  }
+
+  cell sysreq_n = RelocateAmxOpcode(AMX_OP_SYSREQ_N);
+  cell bounds_nop = RelocateAmxOpcode(AMX_OP_BOUNDS_NOP);
+
+  while (disas.Decode(instr)) {
+    AMXOpcode opcode = instr.opcode();
+    cell code = *reinterpret_cast<cell*>(amx_.GetCode() + instr.address());
+    if (code == sysreq_n) {
+      opcode = AMX_OP_SYSREQ_N;
+    } else if (code == bounds_nop) {
+      opcode = AMX_OP_BOUNDS_NOP;
+    }
+    const AMXSuperinstruction *super =
+      FindAmxSuperinstruction(prev_instr.opcode(), opcode);
+    if (super != 0) {
+      cell *opcode = reinterpret_cast<cell*>(amx_.GetCode()
+                                             + prev_instr.address());
+      *opcode = RelocateAmxOpcode(super->opcode);
+      count++;
+    }
+    prev_instr = instr;
+  }
+
+  return count;
+}
+
+int AMXOptimizer::UseDirectNatives() {
+  if (!AmxHasInternalOpcodes()) {
+    return 0;
+  }
+
+  AMXDisassembler disas(amx_);
+  AMXInstruction instr;
+  int count = 0;
+
+  while (disas.Decode(instr)) {
+    if (instr.opcode() == AMX_OP_SYSREQ_C) {
+      cell *opcode = reinterpret_cast<cell*>(amx_.GetCode()
+                                             + instr.address());
+      *opcode = RelocateAmxOpcode(AMX_OP_SYSREQ_N);
+      count++;
+    }
+  }
+
+  return count;
+}
+
+int AMXOptimizer::RemoveRedundantChecks(const AMXVerifier &verifier) {
+  if (!AmxHasInternalOpcodes()) {
+    return 0;
+  }
+
+  AMXDisassembler disas(amx_);
+  AMXInstruction instr;
+  int count = 0;
+
+  while (disas.Decode(instr)) {
+    AMXOpcode opcode;
+    switch (instr.opcode()) {
+      case AMX_OP_STACK:
+        if (instr.operand() < 0) {
+          opcode = AMX_OP_STACK_ALLOC;
+        } else if (verifier.IsBalanced(instr.address())) {
+          opcode = AMX_OP_STACK_FREE;
+        } else {
+          continue;
+        }
+        break;
+      case AMX_OP_HEAP:
+        if (instr.operand() > 0) {
+          opcode = AMX_OP_HEAP_ALLOC;
+        } else if (verifier.IsBalanced(instr.address())) {
+          opcode = AMX_OP_HEAP_FREE;
+        } else {
+          continue;
+        }
+        break;
+      default:
+        continue;
+    }
+    cell *code = reinterpret_cast<cell*>(amx_.GetCode() + instr.address());
+    *code = RelocateAmxOpcode(opcode);
+    count++;
+  }
+
+  return count;
+}
+
+int AMXOptimizer::RemoveRedundantBoundsChecks(const AMXVerifier &verifier) {
+  if (!AmxHasInternalOpcodes()) {
+    return 0;
+  }
+
+  std::vector<cell> addresses;
+  verifier.FindRedundantBoundsChecks(addresses);
+
+  for (std::vector<cell>::const_iterator it = addresses.begin();
+       it != addresses.end(); it++) {
+    cell *code = reinterpret_cast<cell*>(amx_.GetCode() + *it);
+    *code = RelocateAmxOpcode(AMX_OP_BOUNDS_NOP);
+  }
+
+  return static_cast<int>(addresses.size());
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef AMXOPTIMIZER_H
+#define AMXOPTIMIZER_H
+
+#include <vector>
+
+#include "amxscript.h"
+
+class AMXVerifier;
+
+// AMXOptimizer prepares the code of a loaded script for the bundled
+// interpreter. Scripts are relocated by the server's amx_Init(), which knows
+// nothing about our changes to amx_Exec(), so everything the bundled
+// amx_BrowseRelocate() does on top of plain relocation has to be redone here.
+class AMXOptimizer {
+ public:
+  explicit AMXOptimizer(AMXScript amx);
+
+  // Sorts case tables for the binary search in OP_SWITCH.
+  void SortCaseTables();
+
+  // Removes BREAK instructions from the code and moves everything after them
+  // back, fixing up jumps, calls, case tables, public function addresses and
+  // the entry point. The rest of the code section is filled with NOPs.
+  // Scripts that compute code addresses at run time (CALL.PRI, JUMP.PRI,
+  // JREL or reading/writing COD, DAT and CIP) are left as they are. On
+  // return breaks holds the original addresses of the removed instructions;
+  // the number of them is returned.
+  int RemoveBreaks(std::vector<cell> &breaks);
+
+  // Replaces the opcodes of common instruction pairs with superinstructions.
+  // Only the first opcode of a pair is changed, so code addresses stay the
+  // same. Returns the number of replaced pairs.
+  int FuseInstructions();
+
+  // Replaces SYSREQ.C with SYSREQ.N, which calls natives directly instead of
+  // going through amx->callback. Returns the number of replaced instructions.
+  int UseDirectNatives();
+
+  // Replaces STACK and HEAP with versions that skip the stack/heap checks
+  // that can't fail: the collision check when memory is released and the
+  // underflow check when it's allocated. Releases are only changed in
+  // functions that the verifier found balanced. Returns the number of
+  // replaced instructions.
+  int RemoveRedundantChecks(const AMXVerifier &verifier);
+
+  // Replaces BOUNDS instructions whose index the verifier has proven to be
+  // in range with a no-op. Returns the number of replaced instructions.
+  int RemoveRedundantBoundsChecks(const AMXVerifier &verifier);
+
+ private:
+  AMXScript amx_;
+};
+
+#endif // !AMXOPTIMIZER_H
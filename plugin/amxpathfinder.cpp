@@ -22,44 +22,58 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
-#include <cstdlib>
+#include <algorithm>
 #include <cstring>
-#include <iterator>
 #include <list>
+#include <utility>
 #include <vector>
 
 #include <amx/amxaux.h>
 
+#include "amxdisasm.h"
 #include "amxpathfinder.h"
 #include "amxscript.h"
 #include "fileutils.h"
+#include "threadpool.h"
 
-AMXPathFinder::AMXFile::AMXFile(const std::string &name)
- : amx_(reinterpret_cast<AMX*>(std::malloc(sizeof(*amx_)))),
-   name_(name),
-   mtime_(fileutils::GetModificationTime(name))
+namespace {
+
+const char kDebugInfoExtension[] = ".dbg";
+
+} // anonymous namespace
+
+AMXPathFinder::AMXFile::AMXFile()
+ : loaded_(false),
+   mtime_(0),
+   fingerprint_(0)
 {
-  if (amx_ != 0) {
-    if (aux_LoadProgram(amx_, name.c_str(), 0) != AMX_ERR_NONE) {
-      std::free(amx_);
-      amx_ = 0;
-    }
-  }
+  std::memset(&header_, 0, sizeof(header_));
 }
 
-AMXPathFinder::AMXFile::~AMXFile() {
-  if (amx_ != 0) {
-    aux_FreeProgram(amx_);
-    std::free(amx_);
+// The program is loaded only to compute the fingerprint the same way as for
+// a running script, and freed right away.
+AMXPathFinder::AMXFile::AMXFile(const std::string &name, std::time_t mtime)
+ : loaded_(false),
+   name_(name),
+   mtime_(mtime),
+   fingerprint_(0)
+{
+  std::memset(&header_, 0, sizeof(header_));
+  AMX amx;
+  if (aux_LoadProgram(&amx, name.c_str(), 0) == AMX_ERR_NONE) {
+    std::memcpy(&header_, amx.base, sizeof(header_));
+    fingerprint_ = GetAmxFingerprint(&amx);
+    loaded_ = true;
+    aux_FreeProgram(&amx);
   }
 }
 
-AMXPathFinder::~AMXPathFinder() {
-  for (StringToAMXFileMap::const_iterator mapIter = string_to_amx_file_.begin(); 
-      mapIter != string_to_amx_file_.end(); ++mapIter) 
-  {
-    delete mapIter->second;
-  }
+const std::size_t AMXPathFinder::kDefaultMaxCachedFiles;
+
+AMXPathFinder::AMXPathFinder(std::size_t max_cached_files)
+ : max_cached_files_(max_cached_files),
+   cache_size_(max_cached_files)
+{
 }
 
 void AMXPathFinder::AddSearchPath(const std::string &path) {
@@ -75,43 +89,16 @@ std::string AMXPathFinder::FindAmx(AMXScript amx) {
 
   std::string result;
 
-  // Load all .amx files in each of the current search paths (non-recursive).
-  for (std::list<std::string>::const_iterator dir_iterator = search_paths_.begin(); 
-      dir_iterator != search_paths_.end(); ++dir_iterator) 
-  {
-    std::vector<std::string> files;
-    fileutils::GetDirectoryFiles(*dir_iterator, "*.amx", files);
-
-    for (std::vector<std::string>::iterator file_iterator = files.begin(); 
-        file_iterator != files.end(); ++file_iterator) 
-    {
-      std::string filename;
-      filename.append(*dir_iterator);
-      filename.append(fileutils::kNativePathSepString);
-      filename.append(*file_iterator);
-
-      std::time_t mtime = fileutils::GetModificationTime(filename);
-
-      StringToAMXFileMap::iterator script_it = string_to_amx_file_.find(filename);
-      if (script_it == string_to_amx_file_.end() || 
-          script_it->second->mtime() < mtime) {
-        if (script_it != string_to_amx_file_.end()) {
-          string_to_amx_file_.erase(script_it);
-        }
-        AMXFile *script = new AMXFile(filename);
-        if (script != 0 && script->IsLoaded()) {
-          string_to_amx_file_.insert(std::make_pair(filename, script));
-        }
-      }
-    }
-  }  
+  std::vector<AMXFile> files;
+  ScanSearchPaths("*.amx", files);
 
-  for (StringToAMXFileMap::const_iterator mapIter = string_to_amx_file_.begin(); 
-      mapIter != string_to_amx_file_.end(); ++mapIter) 
+  for (std::vector<AMXFile>::const_iterator file_iterator = files.begin();
+      file_iterator != files.end(); ++file_iterator)
   {
-    const AMX *otherAmx = mapIter->second->amx();
-    if (std::memcmp(amx.GetHeader(), otherAmx->base, sizeof(AMX_HEADER)) == 0) {
-      result = mapIter->first;
+    if (file_iterator->IsLoaded() &&
+        std::memcmp(amx.GetHeader(), &file_iterator->header(),
+                    sizeof(AMX_HEADER)) == 0) {
+      result = file_iterator->name();
       amx_to_string_.insert(std::make_pair(amx, result));
       break;
     }
@@ -119,3 +106,204 @@ std::string AMXPathFinder::FindAmx(AMXScript amx) {
 
   return result;
 }
+
+std::string AMXPathFinder::FindDebugInfo(AMXScript amx) {
+  uint32_t fingerprint = GetAmxFingerprint(amx);
+
+  std::string amx_path = FindAmx(amx);
+  if (!amx_path.empty()) {
+    std::string filename = amx_path + kDebugInfoExtension;
+    std::time_t mtime = fileutils::GetModificationTime(filename);
+    if (mtime != 0 && IsDebugInfoFor(GetFile(filename, mtime), fingerprint)) {
+      return filename;
+    }
+  }
+
+  std::vector<AMXFile> files;
+  ScanSearchPaths(std::string("*.amx") + kDebugInfoExtension, files);
+
+  for (std::vector<AMXFile>::const_iterator file_iterator = files.begin();
+      file_iterator != files.end(); ++file_iterator)
+  {
+    if (IsDebugInfoFor(*file_iterator, fingerprint)) {
+      return file_iterator->name();
+    }
+  }
+
+  return std::string();
+}
+
+void AMXPathFinder::Forget(AMXScript amx) {
+  amx_to_string_.erase(amx);
+}
+
+std::size_t AMXPathFinder::Preload(
+    std::vector<std::string> &debug_info_files) {
+  std::vector<AMXFile> files;
+  ScanSearchPaths("*.amx", files);
+  ScanSearchPaths(std::string("*.amx") + kDebugInfoExtension, files);
+
+  for (std::vector<AMXFile>::const_iterator file_iterator = files.begin();
+      file_iterator != files.end(); ++file_iterator)
+  {
+    if (file_iterator->IsLoaded() &&
+        (file_iterator->header().flags & AMX_FLAG_DEBUG) != 0) {
+      debug_info_files.push_back(file_iterator->name());
+    }
+  }
+
+  return files.size();
+}
+
+const AMXPathFinder::AMXFile &AMXPathFinder::GetFile(
+    const std::string &filename, std::time_t mtime) {
+  const AMXFile *file = FindCachedFile(filename, mtime);
+  if (file != 0) {
+    return *file;
+  }
+  return CacheFile(AMXFile(filename, mtime));
+}
+
+const AMXPathFinder::AMXFile *AMXPathFinder::FindCachedFile(
+    const std::string &filename, std::time_t mtime) {
+  StringToAMXFileMap::iterator map_iterator =
+    string_to_amx_file_.find(filename);
+  if (map_iterator != string_to_amx_file_.end()) {
+    AMXFileList::iterator file_iterator = map_iterator->second;
+    if (file_iterator->mtime() == mtime) {
+      files_.splice(files_.begin(), files_, file_iterator);
+      return &*file_iterator;
+    }
+  }
+  return 0;
+}
+
+const AMXPathFinder::AMXFile &AMXPathFinder::CacheFile(const AMXFile &file) {
+  StringToAMXFileMap::iterator map_iterator =
+    string_to_amx_file_.find(file.name());
+  if (map_iterator != string_to_amx_file_.end()) {
+    files_.erase(map_iterator->second);
+    string_to_amx_file_.erase(map_iterator);
+  }
+
+  files_.push_front(file);
+  string_to_amx_file_.insert(std::make_pair(file.name(), files_.begin()));
+
+  while (files_.size() > cache_size_ && files_.size() > 1) {
+    string_to_amx_file_.erase(files_.back().name());
+    files_.pop_back();
+  }
+
+  return files_.front();
+}
+
+void AMXPathFinder::UpdateCacheSize() {
+  std::size_t num_files = 0;
+  for (PatternToCountMap::const_iterator it = num_scanned_files_.begin();
+       it != num_scanned_files_.end(); it++) {
+    num_files += it->second;
+  }
+  cache_size_ = std::max(max_cached_files_, num_files);
+}
+
+struct AMXPathFinder::ScanState {
+  std::string pattern;
+  std::vector<std::string> directories;
+
+  // Names and modification times of the files found in each directory.
+  typedef std::vector<std::pair<std::string, std::time_t> > FileList;
+  std::vector<FileList> directory_files;
+
+  // Files that are not in the cache and need to be read.
+  std::vector<std::pair<std::string, std::time_t> > new_files;
+  std::vector<AMXFile> new_file_info;
+};
+
+void AMXPathFinder::ScanSearchPaths(const std::string &pattern,
+                                    std::vector<AMXFile> &files) {
+  ScanState state;
+  state.pattern = pattern;
+  state.directories.assign(search_paths_.begin(), search_paths_.end());
+  state.directory_files.resize(state.directories.size());
+
+  ThreadPool pool;
+  pool.Run(ScanDirectory, &state, state.directories.size());
+  pool.Wait();
+
+  std::size_t num_files = 0;
+  for (std::size_t i = 0; i < state.directory_files.size(); i++) {
+    num_files += state.directory_files[i].size();
+  }
+  num_scanned_files_[pattern] = num_files;
+  UpdateCacheSize();
+
+  // Take what we can from the cache. The rest is read in parallel and then
+  // cached; this is done afterwards because caching may evict the files
+  // found here.
+  std::vector<std::size_t> new_file_indices;
+
+  for (std::size_t i = 0; i < state.directory_files.size(); i++) {
+    const ScanState::FileList &directory_files = state.directory_files[i];
+    for (std::size_t j = 0; j < directory_files.size(); j++) {
+      const AMXFile *file = FindCachedFile(directory_files[j].first,
+                                           directory_files[j].second);
+      if (file != 0) {
+        files.push_back(*file);
+      } else {
+        files.push_back(AMXFile());
+        new_file_indices.push_back(files.size() - 1);
+        state.new_files.push_back(directory_files[j]);
+      }
+    }
+  }
+
+  if (state.new_files.empty()) {
+    return;
+  }
+
+  state.new_file_info.resize(state.new_files.size());
+  pool.Run(ReadFile, &state, state.new_files.size());
+  pool.Wait();
+
+  for (std::size_t i = 0; i < new_file_indices.size(); i++) {
+    files[new_file_indices[i]] = CacheFile(state.new_file_info[i]);
+  }
+}
+
+// static
+void AMXPathFinder::ScanDirectory(void *args, std::size_t index) {
+  ScanState *state = static_cast<ScanState*>(args);
+  const std::string &directory = state->directories[index];
+
+  std::vector<std::string> names;
+  fileutils::GetDirectoryFiles(directory, state->pattern, names);
+
+  ScanState::FileList &files = state->directory_files[index];
+  files.reserve(names.size());
+
+  for (std::vector<std::string>::iterator name_iterator = names.begin(); 
+      name_iterator != names.end(); ++name_iterator) 
+  {
+    std::string filename;
+    filename.append(directory);
+    filename.append(fileutils::kNativePathSepString);
+    filename.append(*name_iterator);
+
+    std::time_t mtime = fileutils::GetModificationTime(filename);
+    files.push_back(std::make_pair(filename, mtime));
+  }
+}
+
+// static
+void AMXPathFinder::ReadFile(void *args, std::size_t index) {
+  ScanState *state = static_cast<ScanState*>(args);
+  state->new_file_info[index] = AMXFile(state->new_files[index].first,
+                                        state->new_files[index].second);
+}
+
+// static
+bool AMXPathFinder::IsDebugInfoFor(const AMXFile &file, uint32_t fingerprint) {
+  return file.IsLoaded()
+      && (file.header().flags & AMX_FLAG_DEBUG) != 0
+      && file.fingerprint() == fingerprint;
+}
@@ -25,17 +25,33 @@
 #ifndef AMXPATHFINDER_H
 #define AMXPATHFINDER_H
 
+#include <cstddef>
 #include <ctime>
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
+
+#include <amx/amx.h>
 
 #include "amxscript.h"
 
 // AMXPathFinder can search for an .amx file corresponding to a given AMX instance.
+//
+// Files found in the search paths are remembered along with their header and
+// fingerprint (but not the code) until they change on disk, so that a single
+// AMXPathFinder can serve all scripts without scanning the files over and over
+// again. Only the max_cached_files most recently seen files are kept, or as
+// many as the latest scan for each file pattern found if that's more, so
+// that the search paths can't outgrow the cache.
+//
+// The search paths are listed and the new or modified files are read on
+// several threads (see ThreadPool), one directory per thread.
 class AMXPathFinder {
  public:
-  ~AMXPathFinder();
+  static const std::size_t kDefaultMaxCachedFiles = 256;
+
+  explicit AMXPathFinder(std::size_t max_cached_files = kDefaultMaxCachedFiles);
 
   // Adds directory to a set of search paths
   void AddSearchPath(const std::string &path);
@@ -43,18 +59,33 @@ class AMXPathFinder {
   // Same as above but returns the path as a string (which can be empty)
   std::string FindAmx(AMXScript amx);
 
- private:
-  std::list<std::string> search_paths_;
+  // Searches for a debug info file (.amx.dbg) for a script that was stripped
+  // of its debug info. Such a file is a copy of the script before stripping;
+  // it is looked for next to the .amx file and then in the search paths and
+  // must have the same code (see GetAmxFingerprint). Must be called before
+  // the script's code is modified.
+  std::string FindDebugInfo(AMXScript amx);
 
+  // Forgets the path found for the script, to be called when it's unloaded
+  // (another script may be loaded at the same address later).
+  void Forget(AMXScript amx);
+
+  // Reads all .amx and .amx.dbg files in the search paths in advance, so that
+  // looking up scripts later only needs to check their modification times.
+  // Returns the number of files found; the names of those that contain debug
+  // info are added to debug_info_files.
+  std::size_t Preload(std::vector<std::string> &debug_info_files);
+
+ private:
   class AMXFile {
    public:
-    explicit AMXFile(const std::string &name);
-    ~AMXFile();
+    AMXFile();
+    AMXFile(const std::string &name, std::time_t mtime);
 
-    bool IsLoaded() const { return amx_ != 0; }
+    bool IsLoaded() const { return loaded_; }
 
-    const AMX *amx() const {
-      return amx_;
+    const AMX_HEADER &header() const {
+      return header_;
     }
     const std::string &name() const {
       return name_; 
@@ -62,19 +93,57 @@ class AMXPathFinder {
     std::time_t mtime() const {
       return mtime_;
     }
+    uint32_t fingerprint() const {
+      return fingerprint_;
+    }
 
    private:
-    AMXFile(const AMXFile &other);
-    AMXFile &operator=(const AMXFile &other);
-
-   private:
-    AMX *amx_;
+    bool loaded_;
+    AMX_HEADER header_;
     std::string name_;
     std::time_t mtime_;
+    uint32_t fingerprint_;
   };
 
+  // Returns the cached information about a file, reading it if it's not
+  // cached or has been modified.
+  const AMXFile &GetFile(const std::string &filename, std::time_t mtime);
+
+  // Same as above but doesn't read the file: returns 0 if it's not cached.
+  const AMXFile *FindCachedFile(const std::string &filename, std::time_t mtime);
+
+  // Puts a file into the cache, replacing any older version of it.
+  const AMXFile &CacheFile(const AMXFile &file);
+
+  // Makes room in the cache for all files found by the latest scans.
+  void UpdateCacheSize();
+
+  // Gets files matching the pattern in each of the search paths
+  // (non-recursive).
+  void ScanSearchPaths(const std::string &pattern, std::vector<AMXFile> &files);
+
+  struct ScanState;
+
+  // ThreadPool tasks used by ScanSearchPaths().
+  static void ScanDirectory(void *args, std::size_t index);
+  static void ReadFile(void *args, std::size_t index);
+
+  static bool IsDebugInfoFor(const AMXFile &file, uint32_t fingerprint);
+
  private:
-  typedef std::map<std::string, AMXFile*> StringToAMXFileMap;
+  std::list<std::string> search_paths_;
+
+  // Most recently used first.
+  typedef std::list<AMXFile> AMXFileList;
+  AMXFileList files_;
+  std::size_t max_cached_files_;
+  std::size_t cache_size_;
+
+  // Number of files found by the latest scan for each pattern.
+  typedef std::map<std::string, std::size_t> PatternToCountMap;
+  PatternToCountMap num_scanned_files_;
+
+  typedef std::map<std::string, AMXFileList::iterator> StringToAMXFileMap;
   StringToAMXFileMap string_to_amx_file_;
 
   typedef std::map<AMX*, std::string> AMXToStringMap;
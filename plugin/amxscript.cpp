@@ -25,6 +25,7 @@
 #include <cstring>
 
 #include "amxscript.h"
+#include "amxscriptindex.h"
 
 AMXScript::AMXScript(AMX *amx)
  : amx_(amx)
@@ -62,6 +63,10 @@ const AMX_FUNCSTUBNT *AMXScript::GetPublics() const {
 }
 
 const char *AMXScript::FindPublic(cell address) const {
+  if (const AMXScriptIndex *index = AMXScriptIndex::Find(amx_)) {
+    cell i = index->FindPublic(address);
+    return i >= 0 ? GetPublicName(i) : 0;
+  }
   const AMX_FUNCSTUBNT *publics = GetPublics();
   int n = GetNumPublics();
   for (int i = 0; i < n; i++) {
@@ -94,6 +99,9 @@ int AMXScript::GetNumPublics() const {
 }
 
 cell AMXScript::GetNativeIndex(const char *name) const {
+  if (const AMXScriptIndex *index = AMXScriptIndex::Find(amx_)) {
+    return index->GetNativeIndex(name);
+  }
   int n = GetNumNatives();
   const AMX_FUNCSTUBNT *natives = GetNatives();
   for (int i = 0; i < n; i++) {
@@ -105,6 +113,9 @@ cell AMXScript::GetNativeIndex(const char *name) const {
 }
 
 cell AMXScript::GetPublicIndex(const char *name) const {
+  if (const AMXScriptIndex *index = AMXScriptIndex::Find(amx_)) {
+    return index->GetPublicIndex(name);
+  }
   int n = GetNumPublics();
   const AMX_FUNCSTUBNT *publics = GetPublics();
   for (int i = 0; i < n; i++) {
@@ -67,6 +67,7 @@ class AMXScript {
   cell GetPri() const { return amx_->pri; }
   cell GetAlt() const { return amx_->alt; }
 
+  void SetCip(cell cip) { amx_->cip = cip; }
   void SetFrm(cell frm) { amx_->frm = frm; }
   void SetHea(cell hea) { amx_->hea = hea; }
   void SetStk(cell stk) { amx_->stk = stk; }
@@ -0,0 +1,210 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstring>
+
+#include "amxdisasm.h"
+#include "amxscriptindex.h"
+
+namespace {
+
+const char *const kCallbackNames[] = {
+  "OnRuntimeError"
+};
+
+} // anonymous namespace
+
+AMXScriptIndex::IndexMap AMXScriptIndex::index_map_;
+
+AMXScriptIndex::AMXScriptIndex(AMXScript amx)
+ : amx_(amx),
+   code_size_(0)
+{
+  IndexPublics();
+
+  const AMX_FUNCSTUBNT *natives = amx.GetNatives();
+  int num_natives = amx.GetNumNatives();
+  for (int i = 0; i < num_natives; i++) {
+    natives_.Insert(amx.GetName(natives[i].nameofs), i);
+  }
+
+  const AMX_HEADER *hdr = amx.GetHeader();
+  code_size_ = hdr->dat - hdr->cod;
+
+  // Every function compiled by pawncc begins with PROC, but some may be
+  // reached only through CALL (e.g. hand-written #emit code).
+  AMXDisassembler disas(amx);
+  AMXInstruction instr;
+  while (disas.Decode(instr)) {
+    switch (instr.opcode()) {
+      case AMX_OP_PROC:
+        functions_.push_back(instr.address());
+        break;
+      case AMX_OP_CALL:
+        if (static_cast<ucell>(instr.operand()) < code_size_) {
+          functions_.push_back(instr.operand());
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  for (std::size_t i = 0; i < public_addresses_.size(); i++) {
+    functions_.push_back(public_addresses_[i].first);
+  }
+  if (hdr->cip >= 0) {
+    functions_.push_back(hdr->cip);
+  }
+  std::sort(functions_.begin(), functions_.end());
+  functions_.erase(std::unique(functions_.begin(), functions_.end()),
+                   functions_.end());
+  std::vector<ucell>(functions_).swap(functions_);
+}
+
+cell AMXScriptIndex::GetPublicIndex(const char *name) const {
+  cell index = publics_.Find(name);
+  if (index >= 0 ? !IsPublic(index, name) : HavePublicsChanged()) {
+    IndexPublics();
+    index = publics_.Find(name);
+  }
+  return index;
+}
+
+cell AMXScriptIndex::GetNativeIndex(const char *name) const {
+  return natives_.Find(name);
+}
+
+cell AMXScriptIndex::FindPublic(cell address) const {
+  for (int attempt = 0; attempt < 2; attempt++) {
+    // If several publics share the address this finds the first one, just
+    // like a linear search would.
+    std::vector<AddressIndexPair>::const_iterator it =
+      std::lower_bound(public_addresses_.begin(), public_addresses_.end(),
+                       std::make_pair(static_cast<ucell>(address), cell(0)));
+    if (it != public_addresses_.end()
+        && it->first == static_cast<ucell>(address)) {
+      if (it->second < amx_.GetNumPublics()
+          && amx_.GetPublics()[it->second].address == it->first) {
+        return it->second;
+      }
+    } else if (static_cast<std::size_t>(amx_.GetNumPublics())
+               == public_table_.size()) {
+      // Most stack frames are not publics, so a miss doesn't check the
+      // whole table.
+      return -1;
+    }
+    IndexPublics();
+  }
+  return -1;
+}
+
+cell AMXScriptIndex::FindFunction(cell address) const {
+  if (static_cast<ucell>(address) >= code_size_) {
+    return -1;
+  }
+  std::vector<ucell>::const_iterator it =
+    std::upper_bound(functions_.begin(), functions_.end(),
+                     static_cast<ucell>(address));
+  if (it == functions_.begin()) {
+    return -1;
+  }
+  return *--it;
+}
+
+cell AMXScriptIndex::GetCallbackIndex(Callback callback) const {
+  cell index = callbacks_[callback];
+  if (index >= 0 ? !IsPublic(index, kCallbackNames[callback])
+                 : HavePublicsChanged()) {
+    IndexPublics();
+    index = callbacks_[callback];
+  }
+  return index;
+}
+
+void AMXScriptIndex::IndexPublics() const {
+  const AMX_FUNCSTUBNT *publics = amx_.GetPublics();
+  int num_publics = amx_.GetNumPublics();
+
+  public_table_.clear();
+  publics_ = NameTable();
+  public_addresses_.clear();
+
+  for (int i = 0; i < num_publics; i++) {
+    public_table_.push_back(publics[i].address);
+    publics_.Insert(amx_.GetName(publics[i].nameofs), i);
+    public_addresses_.push_back(std::make_pair(publics[i].address, i));
+  }
+  std::sort(public_addresses_.begin(), public_addresses_.end());
+
+  for (int i = 0; i < kNumCallbacks; i++) {
+    callbacks_[i] = publics_.Find(kCallbackNames[i]);
+  }
+}
+
+// Compares both the addresses and the names, as names may be changed in
+// place.
+bool AMXScriptIndex::HavePublicsChanged() const {
+  const AMX_FUNCSTUBNT *publics = amx_.GetPublics();
+  int num_publics = amx_.GetNumPublics();
+  if (static_cast<std::size_t>(num_publics) != public_table_.size()) {
+    return true;
+  }
+  for (int i = 0; i < num_publics; i++) {
+    if (publics[i].address != public_table_[i]
+        || publics_.Find(amx_.GetName(publics[i].nameofs)) != i) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool AMXScriptIndex::IsPublic(cell index, const char *name) const {
+  return index < amx_.GetNumPublics()
+      && std::strcmp(amx_.GetPublicName(index), name) == 0;
+}
+
+// static
+void AMXScriptIndex::Create(AMXScript amx) {
+  Destroy(amx);
+  index_map_[amx] = new AMXScriptIndex(amx);
+}
+
+// static
+const AMXScriptIndex *AMXScriptIndex::Find(AMXScript amx) {
+  IndexMap::const_iterator iterator = index_map_.find(amx);
+  if (iterator != index_map_.end()) {
+    return iterator->second;
+  }
+  return 0;
+}
+
+// static
+void AMXScriptIndex::Destroy(AMXScript amx) {
+  IndexMap::iterator iterator = index_map_.find(amx);
+  if (iterator != index_map_.end()) {
+    delete iterator->second;
+    index_map_.erase(iterator);
+  }
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef AMXSCRIPTINDEX_H
+#define AMXSCRIPTINDEX_H
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <amx/amx.h>
+
+#include "amxscript.h"
+#include "nametable.h"
+
+// Public and native function lookup tables for a script. The index is
+// built once, after the script's code has been finalized, and is then used
+// by all AMXScript objects referring to that AMX. Native addresses are not
+// indexed since they are only known once all plugins have registered their
+// natives.
+//
+// Some libraries (e.g. y_hooks) rename and reorder publics at run time, so
+// public lookups check what they found against the script's public table
+// and index the publics again if it doesn't match. When nothing is found
+// by name the whole table is checked for changes; when nothing is found by
+// address only the number of publics is.
+//
+// The index also records where each function starts, which is found by
+// scanning the code for PROC instructions and CALL targets. This lets stack
+// traces name functions of scripts compiled without debug info.
+class AMXScriptIndex {
+ public:
+  enum Callback {
+    kOnRuntimeError,
+    kNumCallbacks
+  };
+
+  explicit AMXScriptIndex(AMXScript amx);
+
+  cell GetPublicIndex(const char *name) const;
+  cell GetNativeIndex(const char *name) const;
+
+  // Returns the index of the public function at the given address or -1.
+  cell FindPublic(cell address) const;
+
+  // Returns the start address of the function containing the given code
+  // address or -1. Functions are assumed to extend up to the next one.
+  cell FindFunction(cell address) const;
+
+  // Index of a callback CrashDetect calls, -1 if it is not defined.
+  cell GetCallbackIndex(Callback callback) const;
+
+ public:
+  static void Create(AMXScript amx);
+  static const AMXScriptIndex *Find(AMXScript amx);
+  static void Destroy(AMXScript amx);
+
+ private:
+  void IndexPublics() const;
+  bool HavePublicsChanged() const;
+  bool IsPublic(cell index, const char *name) const;
+
+ private:
+  typedef std::pair<ucell, cell> AddressIndexPair;
+
+  AMXScript amx_;
+  mutable std::vector<ucell> public_table_; // addresses when indexed
+  mutable NameTable publics_;
+  NameTable natives_;
+  mutable std::vector<AddressIndexPair> public_addresses_; // sorted
+  std::vector<ucell> functions_; // sorted start addresses
+  ucell code_size_;
+  mutable cell callbacks_[kNumCallbacks];
+
+  typedef std::map<const AMX*, AMXScriptIndex*> IndexMap;
+  static IndexMap index_map_;
+};
+
+#endif // !AMXSCRIPTINDEX_H
@@ -45,12 +45,13 @@ class AMXService {
  public:
   static T *Create(AMXScript amx);
   static T *Get(AMXScript amx);
+  static T *Find(AMXScript amx);
   static void Destroy(AMXScript amx);
 
  private:
   AMXScript amx_;
 
- private:
+ protected:
   typedef std::map<AMX*, T*> ServiceMap;
   static ServiceMap service_map_;
 };
@@ -76,6 +77,16 @@ T *AMXService<T>::Get(AMXScript amx) {
   return Create(amx);
 }
 
+// static
+template<typename T>
+T *AMXService<T>::Find(AMXScript amx) {
+  typename ServiceMap::const_iterator iterator = service_map_.find(amx);
+  if (iterator != service_map_.end()) {
+    return iterator->second;
+  }
+  return 0;
+}
+
 // static
 template<typename T>
 void AMXService<T>::Destroy(AMXScript amx) {
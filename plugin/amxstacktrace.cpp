@@ -35,6 +35,7 @@
 #include "amxdebuginfo.h"
 #include "amxopcode.h"
 #include "amxscript.h"
+#include "amxscriptindex.h"
 #include "amxstacktrace.h"
 
 namespace {
@@ -384,10 +385,24 @@ std::vector<cell> GetStateIDs(AMXScript amx, cell function_address,
 
 AMXStackFramePrinter::AMXStackFramePrinter()
  : stream_(0),
-   debug_info_(0)
+   debug_info_(0),
+   removed_breaks_(0),
+   at_instruction_(false)
 {
 }
 
+// static
+cell AMXStackFramePrinter::GetOriginalAddress(
+  const std::vector<cell> &removed_breaks,
+  cell address)
+{
+  for (std::vector<cell>::const_iterator it = removed_breaks.begin();
+       it != removed_breaks.end() && *it <= address; it++) {
+    address += sizeof(cell);
+  }
+  return address;
+}
+
 void AMXStackFramePrinter::Print(const AMXStackFrame &frame) {
   PrintReturnAddress(frame);
   *stream_ << " in ";
@@ -425,24 +440,50 @@ void AMXStackFramePrinter::PrintReturnAddress(const AMXStackFrame &frame) {
   if (frame.return_address() == 0) {
     *stream_ << "????????";
   } else {
+    cell address = frame.return_address();
+    if (removed_breaks_ != 0) {
+      if (at_instruction_) {
+        address = GetOriginalAddress(*removed_breaks_, address);
+      } else {
+        // Map the last operand of the call so that a BREAK that followed it
+        // still counts as the return address.
+        address = GetOriginalAddress(*removed_breaks_,
+                                     address - sizeof(cell)) + sizeof(cell);
+      }
+    }
     char old_fill = stream_->fill('0');
     *stream_ << std::hex << std::setw(kCellWidthChars)
-             << frame.return_address()
+             << address
              << std::dec;
     stream_->fill(old_fill);
   }
 }
 
 void AMXStackFramePrinter::PrintCallerName(const AMXStackFrame &frame) {
-  if (IsMain(frame.amx(), frame.caller_address())) {
+  cell caller_address = frame.caller_address();
+
+  // Without debug info fall back to the function boundaries recovered from
+  // the code at load time.
+  const AMXScriptIndex *index = AMXScriptIndex::Find(frame.amx());
+  if (caller_address == 0 && index != 0 && frame.return_address() != 0) {
+    caller_address = std::max(index->FindFunction(frame.return_address()),
+                              cell(0));
+  }
+
+  if (IsMain(frame.amx(), caller_address)) {
     *stream_ << "main";
   } else {
     const char *name = 0;
-    if (frame.caller_address() != 0) {
-      name = frame.amx().FindPublic(frame.caller_address());
+    if (caller_address != 0) {
+      name = frame.amx().FindPublic(caller_address);
     }
     if (name != 0) {
       *stream_ << "public " << name;
+    } else if (caller_address != 0 && index != 0) {
+      char old_fill = stream_->fill('0');
+      *stream_ << "func@0x" << std::hex << std::setw(kCellWidthChars)
+               << caller_address << std::dec;
+      stream_->fill(old_fill);
     } else {
       *stream_ << "??";
     }
@@ -497,11 +538,7 @@ void AMXStackFramePrinter::PrintArgument(const AMXStackFrame &frame,
 
 void AMXStackFramePrinter::PrintArgumentValue(const AMXStackFrame &frame,
                                               int index) {
-  cell value = GetArgumentValue(frame.amx(), frame.address(), index);
-  char old_fill = stream_->fill('0');
-  *stream_ << std::hex << "0x" << std::setw(kCellWidthChars)
-           << value << std::dec;
-  stream_->fill(old_fill);
+  PrintRawValue(GetArgumentValue(frame.amx(), frame.address(), index));
 }
 
 void AMXStackFramePrinter::PrintArgumentValue(const AMXStackFrame &frame,
@@ -548,6 +585,13 @@ void AMXStackFramePrinter::PrintArgumentValue(const AMXStackFrame &frame,
   }
 }
 
+void AMXStackFramePrinter::PrintRawValue(cell value) {
+  char old_fill = stream_->fill('0');
+  *stream_ << std::hex << "0x" << std::setw(kCellWidthChars)
+           << value << std::dec;
+  stream_->fill(old_fill);
+}
+
 void AMXStackFramePrinter::PrintVariableArguments(int number) {
   assert(number > 0);
   *stream_ << "... <" << number << " ";
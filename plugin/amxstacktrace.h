@@ -26,6 +26,7 @@
 #define AMXSTACKTRACE_H
 
 #include <iosfwd>
+#include <vector>
 
 #include "amxscript.h"
 
@@ -109,6 +110,24 @@ class AMXStackFramePrinter {
     debug_info_ = debug_info;
   }
 
+  // Sorted addresses of BREAK instructions removed from the code (see
+  // AMXOptimizer::RemoveBreaks). Addresses are then printed as they were
+  // in the original code.
+  void set_removed_breaks(const std::vector<cell> *removed_breaks) {
+    removed_breaks_ = removed_breaks;
+  }
+
+  // Set if the return address of the frame is the instruction currently
+  // being executed rather than an address following a call.
+  void set_at_instruction(bool at_instruction) {
+    at_instruction_ = at_instruction;
+  }
+
+  // Maps an address in the code with the given BREAKs removed back to the
+  // original code.
+  static cell GetOriginalAddress(const std::vector<cell> &removed_breaks,
+                                 cell address);
+
   void Print(const AMXStackFrame &frame);
 
   void PrintTag(const AMXDebugSymbol &symbol);
@@ -131,6 +150,8 @@ class AMXStackFramePrinter {
                           const AMXDebugSymbol &arg,
                           int index);
 
+  void PrintRawValue(cell value);
+
   void PrintVariableArguments(int number);
 
   void PrintArgumentList(const AMXStackFrame &frame);
@@ -148,6 +169,8 @@ class AMXStackFramePrinter {
  private:
   std::ostream *stream_;
   const AMXDebugInfo *debug_info_;
+  const std::vector<cell> *removed_breaks_;
+  bool at_instruction_;
 };
 
 #endif // !AMXSTACKTRACE_H
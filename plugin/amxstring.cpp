@@ -0,0 +1,470 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <climits>
+#include <cstring>
+#include <cwchar>
+
+#if defined _MSC_VER
+  #include <intrin.h>
+#elif defined __GNUC__
+  #include <cpuid.h>
+#endif
+
+#include <emmintrin.h>
+#if !defined __GNUC__ || defined __clang__ || \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+  #include <immintrin.h>
+  #define HAVE_AVX2
+#endif
+
+#include "amxstring.h"
+
+// GCC only lets us use SSE/AVX intrinsics in functions compiled for them,
+// the rest of the plugin must still run on any x86 CPU.
+#if defined __GNUC__
+  #define TARGET(isa) __attribute__((target(isa)))
+#else
+  #define TARGET(isa)
+#endif
+
+namespace amxstring {
+
+namespace {
+
+typedef std::size_t (*ScanFunc)(const cell *string);
+typedef std::size_t (*NarrowFunc)(char *dest, const cell *source,
+                                  std::size_t size);
+typedef void (*WidenFunc)(cell *dest, const char *source, std::size_t length);
+
+inline bool IsAligned(const void *address, std::size_t alignment) {
+  return (reinterpret_cast<std::size_t>(address) & (alignment - 1)) == 0;
+}
+
+inline void SwapCell(ucell *c) {
+  ucell v = *c;
+  *c = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+
+// Returns the length of an unpacked string.
+std::size_t ScanScalar(const cell *string) {
+  const cell *p = string;
+  while (*p != 0) {
+    p++;
+  }
+  return p - string;
+}
+
+// Copies characters of an unpacked string up to the terminating zero or
+// until size characters have been copied. Returns the number of copied
+// characters (no terminator is written).
+std::size_t NarrowScalar(char *dest, const cell *source, std::size_t size) {
+  std::size_t n = 0;
+  while (n < size && source[n] != 0) {
+    dest[n] = static_cast<char>(source[n]);
+    n++;
+  }
+  return n;
+}
+
+// Converts length characters to cells, sign-extending them if char is
+// signed, just like the (cell) cast in amx_SetString().
+void WidenScalar(cell *dest, const char *source, std::size_t length) {
+  for (std::size_t i = 0; i < length; i++) {
+    dest[i] = static_cast<cell>(source[i]);
+  }
+}
+
+// The vector loops only read whole aligned blocks, so they never touch a
+// page the string doesn't extend into, even past the terminator. If the
+// string is not cell-aligned the scalar head loop handles all of it.
+
+TARGET("sse2")
+std::size_t ScanSSE2(const cell *string) {
+  const cell *p = string;
+  while (!IsAligned(p, 16)) {
+    if (*p == 0) {
+      return p - string;
+    }
+    p++;
+  }
+  const __m128i zero = _mm_setzero_si128();
+  for (;;) {
+    __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(v, zero)) != 0) {
+      break;
+    }
+    p += 4;
+  }
+  return (p - string) + ScanScalar(p);
+}
+
+TARGET("sse2")
+std::size_t NarrowSSE2(char *dest, const cell *source, std::size_t size) {
+  std::size_t n = 0;
+  while (n < size && !IsAligned(source + n, 64)) {
+    if (source[n] == 0) {
+      return n;
+    }
+    dest[n] = static_cast<char>(source[n]);
+    n++;
+  }
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i mask = _mm_set1_epi32(0xff);
+  for (; n + 16 <= size; n += 16) {
+    const __m128i *p = reinterpret_cast<const __m128i*>(source + n);
+    __m128i a = _mm_load_si128(p);
+    __m128i b = _mm_load_si128(p + 1);
+    __m128i c = _mm_load_si128(p + 2);
+    __m128i d = _mm_load_si128(p + 3);
+    __m128i z = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi32(a, zero), _mm_cmpeq_epi32(b, zero)),
+      _mm_or_si128(_mm_cmpeq_epi32(c, zero), _mm_cmpeq_epi32(d, zero)));
+    if (_mm_movemask_epi8(z) != 0) {
+      break;
+    }
+    // Keep only the low byte of each cell, then the saturating packs
+    // can't change anything.
+    __m128i ab = _mm_packs_epi32(_mm_and_si128(a, mask),
+                                 _mm_and_si128(b, mask));
+    __m128i cd = _mm_packs_epi32(_mm_and_si128(c, mask),
+                                 _mm_and_si128(d, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + n),
+                     _mm_packus_epi16(ab, cd));
+  }
+  return n + NarrowScalar(dest + n, source + n, size - n);
+}
+
+TARGET("sse2")
+void WidenSSE2(cell *dest, const char *source, std::size_t length) {
+  const __m128i zero = _mm_setzero_si128();
+  std::size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+    #if CHAR_MIN < 0
+      __m128i sign = _mm_cmpgt_epi8(zero, x);
+    #else
+      __m128i sign = zero;
+    #endif
+    __m128i lo = _mm_unpacklo_epi8(x, sign);
+    __m128i hi = _mm_unpackhi_epi8(x, sign);
+    __m128i lo_sign = _mm_srai_epi16(lo, 15);
+    __m128i hi_sign = _mm_srai_epi16(hi, 15);
+    __m128i *p = reinterpret_cast<__m128i*>(dest + i);
+    _mm_storeu_si128(p,     _mm_unpacklo_epi16(lo, lo_sign));
+    _mm_storeu_si128(p + 1, _mm_unpackhi_epi16(lo, lo_sign));
+    _mm_storeu_si128(p + 2, _mm_unpacklo_epi16(hi, hi_sign));
+    _mm_storeu_si128(p + 3, _mm_unpackhi_epi16(hi, hi_sign));
+  }
+  WidenScalar(dest + i, source + i, length - i);
+}
+
+#ifdef HAVE_AVX2
+
+TARGET("avx2")
+std::size_t ScanAVX2(const cell *string) {
+  const cell *p = string;
+  while (!IsAligned(p, 32)) {
+    if (*p == 0) {
+      return p - string;
+    }
+    p++;
+  }
+  const __m256i zero = _mm256_setzero_si256();
+  for (;;) {
+    __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(p));
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(v, zero)) != 0) {
+      break;
+    }
+    p += 8;
+  }
+  return (p - string) + ScanScalar(p);
+}
+
+TARGET("avx2")
+std::size_t NarrowAVX2(char *dest, const cell *source, std::size_t size) {
+  std::size_t n = 0;
+  while (n < size && !IsAligned(source + n, 64)) {
+    if (source[n] == 0) {
+      return n;
+    }
+    dest[n] = static_cast<char>(source[n]);
+    n++;
+  }
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i mask = _mm256_set1_epi32(0xff);
+  for (; n + 16 <= size; n += 16) {
+    const __m256i *p = reinterpret_cast<const __m256i*>(source + n);
+    __m256i a = _mm256_load_si256(p);
+    __m256i b = _mm256_load_si256(p + 1);
+    __m256i z = _mm256_or_si256(_mm256_cmpeq_epi32(a, zero),
+                                _mm256_cmpeq_epi32(b, zero));
+    if (_mm256_movemask_epi8(z) != 0) {
+      break;
+    }
+    // packs works within 128-bit lanes: a0-3 b0-3 | a4-7 b4-7, so put
+    // the quarters back in order before the final pack.
+    __m256i ab = _mm256_packs_epi32(_mm256_and_si256(a, mask),
+                                    _mm256_and_si256(b, mask));
+    ab = _mm256_permute4x64_epi64(ab, 0xd8);
+    __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(ab),
+                                     _mm256_extracti128_si256(ab, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + n), bytes);
+  }
+  return n + NarrowScalar(dest + n, source + n, size - n);
+}
+
+TARGET("avx2")
+void WidenAVX2(cell *dest, const char *source, std::size_t length) {
+  std::size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i lo = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + i));
+    __m128i hi = _mm_loadl_epi64(
+      reinterpret_cast<const __m128i*>(source + i + 8));
+    __m256i *p = reinterpret_cast<__m256i*>(dest + i);
+    #if CHAR_MIN < 0
+      _mm256_storeu_si256(p,     _mm256_cvtepi8_epi32(lo));
+      _mm256_storeu_si256(p + 1, _mm256_cvtepi8_epi32(hi));
+    #else
+      _mm256_storeu_si256(p,     _mm256_cvtepu8_epi32(lo));
+      _mm256_storeu_si256(p + 1, _mm256_cvtepu8_epi32(hi));
+    #endif
+  }
+  WidenScalar(dest + i, source + i, length - i);
+}
+
+#endif // HAVE_AVX2
+
+void CPUID(unsigned int leaf, unsigned int regs[4]) {
+  regs[0] = regs[1] = regs[2] = regs[3] = 0;
+  #if defined _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (leaf <= static_cast<unsigned int>(info[0])) {
+      __cpuidex(info, leaf, 0);
+      for (int i = 0; i < 4; i++) {
+        regs[i] = static_cast<unsigned int>(info[i]);
+      }
+    }
+  #elif defined __GNUC__
+    if (leaf <= __get_cpuid_max(0, 0)) {
+      __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+    }
+  #endif
+}
+
+// Checks that the OS saves the YMM registers on context switches.
+bool IsAVXEnabledByOS() {
+  unsigned int eax;
+  #if defined _MSC_VER
+    eax = static_cast<unsigned int>(_xgetbv(0));
+  #elif defined __GNUC__
+    unsigned int edx;
+    // xgetbv, spelled out for old assemblers
+    __asm__ (".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c"(0));
+  #else
+    eax = 0;
+  #endif
+  return (eax & 6) == 6;
+}
+
+Mode DetectMode() {
+  unsigned int regs[4];
+  CPUID(1, regs);
+  bool sse2 = (regs[3] & (1u << 26)) != 0;
+  bool osxsave = (regs[2] & (1u << 27)) != 0;
+  bool avx = (regs[2] & (1u << 28)) != 0;
+  if (!sse2) {
+    return kScalar;
+  }
+  #ifdef HAVE_AVX2
+    if (osxsave && avx && IsAVXEnabledByOS()) {
+      CPUID(7, regs);
+      if ((regs[1] & (1u << 5)) != 0) {
+        return kAVX2;
+      }
+    }
+  #endif
+  return kSSE2;
+}
+
+const Mode supported_mode = DetectMode();
+
+Mode mode = kScalar;
+ScanFunc scan = ScanScalar;
+NarrowFunc narrow = NarrowScalar;
+WidenFunc widen = WidenScalar;
+
+struct Initializer {
+  Initializer() { SetMode(supported_mode); }
+} initializer;
+
+} // anonymous namespace
+
+Mode GetSupportedMode() {
+  return supported_mode;
+}
+
+Mode GetMode() {
+  return mode;
+}
+
+void SetMode(Mode new_mode) {
+  if (new_mode > supported_mode) {
+    new_mode = supported_mode;
+  }
+  switch (new_mode) {
+    case kScalar:
+      scan = ScanScalar;
+      narrow = NarrowScalar;
+      widen = WidenScalar;
+      break;
+    case kSSE2:
+      scan = ScanSSE2;
+      narrow = NarrowSSE2;
+      widen = WidenSSE2;
+      break;
+    case kAVX2:
+      #ifdef HAVE_AVX2
+        scan = ScanAVX2;
+        narrow = NarrowAVX2;
+        widen = WidenAVX2;
+      #endif
+      break;
+  }
+  mode = new_mode;
+}
+
+const char *GetModeName(Mode mode) {
+  switch (mode) {
+    case kScalar:
+      return "scalar";
+    case kSSE2:
+      return "SSE2";
+    case kAVX2:
+      return "AVX2";
+  }
+  return "?";
+}
+
+int StrLen(const cell *cstr, int *length) {
+  if (cstr == 0) {
+    *length = 0;
+    return AMX_ERR_PARAMS;
+  }
+  if (static_cast<ucell>(*cstr) > UNPACKEDMAX) {
+    // Packed strings are plain C strings except for the byte order,
+    // strlen() is as fast as it gets.
+    int len = static_cast<int>(std::strlen(reinterpret_cast<const char*>(cstr)));
+    ucell c = cstr[len / sizeof(cell)];
+    len -= len % sizeof(cell);
+    while ((c & 0xff000000) != 0) {
+      len++;
+      c <<= 8;
+    }
+    *length = len;
+  } else {
+    *length = static_cast<int>(scan(cstr));
+  }
+  return AMX_ERR_NONE;
+}
+
+int GetString(char *dest, const cell *source, int use_wchar,
+              std::size_t size) {
+  int len = 0;
+  if (static_cast<ucell>(*source) > UNPACKEDMAX) {
+    cell c = 0;
+    int i = sizeof(cell) - 1;
+    while (static_cast<std::size_t>(len) < size) {
+      if (i == sizeof(cell) - 1) {
+        c = *source++;
+      }
+      if (use_wchar) {
+        reinterpret_cast<wchar_t*>(dest)[len++] = static_cast<char>(c >> i * 8);
+      } else {
+        dest[len++] = static_cast<char>(c >> i * 8);
+      }
+      if (dest[len - 1] == '\0') {
+        break;
+      }
+      i = (i + sizeof(cell) - 1) % sizeof(cell);
+    }
+  } else if (use_wchar) {
+    while (*source != 0 && static_cast<std::size_t>(len) < size) {
+      reinterpret_cast<wchar_t*>(dest)[len++] = static_cast<wchar_t>(*source++);
+    }
+  } else {
+    len = static_cast<int>(narrow(dest, source, size));
+  }
+  if (static_cast<std::size_t>(len) >= size) {
+    len = static_cast<int>(size) - 1;
+  }
+  if (len >= 0) {
+    dest[len] = '\0';
+  }
+  return AMX_ERR_NONE;
+}
+
+int SetString(cell *dest, const char *source, int pack, int use_wchar,
+              std::size_t size) {
+  int len;
+  if (use_wchar) {
+    len = static_cast<int>(std::wcslen(reinterpret_cast<const wchar_t*>(source)));
+  } else {
+    len = static_cast<int>(std::strlen(source));
+  }
+  if (pack) {
+    if (size < UNLIMITED / sizeof(cell)
+        && static_cast<std::size_t>(len) >= size * sizeof(cell)) {
+      len = static_cast<int>(size * sizeof(cell)) - 1;
+    }
+    dest[len / sizeof(cell)] = 0;
+    if (use_wchar) {
+      for (int i = 0; i < len; i++) {
+        reinterpret_cast<char*>(dest)[i] =
+          static_cast<char>(reinterpret_cast<const wchar_t*>(source)[i]);
+      }
+    } else {
+      std::memcpy(dest, source, len);
+    }
+    for (len /= sizeof(cell); len >= 0; len--) {
+      SwapCell(reinterpret_cast<ucell*>(&dest[len]));
+    }
+  } else {
+    if (size < UNLIMITED && static_cast<std::size_t>(len) >= size) {
+      len = static_cast<int>(size) - 1;
+    }
+    if (use_wchar) {
+      for (int i = 0; i < len; i++) {
+        dest[i] = static_cast<cell>(reinterpret_cast<const wchar_t*>(source)[i]);
+      }
+    } else if (len > 0) {
+      widen(dest, source, len);
+    }
+    dest[len] = 0;
+  }
+  return AMX_ERR_NONE;
+}
+
+} // namespace amxstring
@@ -0,0 +1,60 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef AMXSTRING_H
+#define AMXSTRING_H
+
+#include <cstddef>
+
+#include <amx/amx.h>
+
+// Drop-in replacements for amx_StrLen(), amx_GetString() and amx_SetString()
+// that convert unpacked strings with SSE2 or AVX2 when the CPU supports it.
+// Packed and wide character strings are handled the same way as in amx.c.
+namespace amxstring {
+
+enum Mode {
+  kScalar,
+  kSSE2,
+  kAVX2
+};
+
+// Returns the best mode supported by the CPU (and the OS, for AVX2).
+Mode GetSupportedMode();
+
+// The mode used by the functions below, GetSupportedMode() by default.
+// SetMode() is for benchmarks and tests; it won't go past what's supported.
+Mode GetMode();
+void SetMode(Mode mode);
+
+const char *GetModeName(Mode mode);
+
+int StrLen(const cell *cstr, int *length);
+int GetString(char *dest, const cell *source, int use_wchar, std::size_t size);
+int SetString(cell *dest, const char *source, int pack, int use_wchar,
+              std::size_t size);
+
+} // namespace amxstring
+
+#endif // !AMXSTRING_H
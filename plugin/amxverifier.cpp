@@ -0,0 +1,1014 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <utility>
+
+#include "amxverifier.h"
+
+namespace {
+
+// Stack (not counting the arguments and the return address) and heap usage
+// before an instruction.
+struct State {
+  cell stack;
+  cell heap;
+  bool visited;
+};
+
+const cell kCellSize = sizeof(cell);
+const cell kMinCell = std::numeric_limits<cell>::min();
+const cell kMaxCell = std::numeric_limits<cell>::max();
+
+// What the bounds check analysis knows about PRI or ALT.
+struct Value {
+  enum Kind {
+    UNKNOWN,
+    NUMBER,     // a known number
+    VARIABLE,   // the current value of the variable
+    COMPARISON  // the result of comparing the variable with a number
+  };
+  Kind kind;
+  cell number;
+  AMXOpcode relation; // SLESS, SLEQ, SGRTR or SGEQ (variable on the left)
+};
+
+bool operator==(const Value &lhs, const Value &rhs) {
+  return lhs.kind == rhs.kind
+      && lhs.number == rhs.number
+      && lhs.relation == rhs.relation;
+}
+
+Value MakeValue(Value::Kind kind, cell number = 0,
+                AMXOpcode relation = AMX_OP_NONE) {
+  Value value = {kind, number, relation};
+  return value;
+}
+
+// The range of values of the variable and what's in PRI and ALT before an
+// instruction.
+struct Range {
+  cell min;
+  cell max;
+  Value pri;
+  Value alt;
+  bool visited;
+  int updates;
+};
+
+// After this many updates of a range its bounds are moved straight to the
+// nearest numbers the function compares with (or to the limits), otherwise
+// loops would have to be followed through every iteration.
+const int kMaxRangeUpdates = 3;
+
+AMXOpcode SwapRelation(AMXOpcode relation) {
+  switch (relation) {
+    case AMX_OP_SLESS: return AMX_OP_SGRTR;
+    case AMX_OP_SLEQ:  return AMX_OP_SGEQ;
+    case AMX_OP_SGRTR: return AMX_OP_SLESS;
+    case AMX_OP_SGEQ:  return AMX_OP_SLEQ;
+    default:           return AMX_OP_NONE;
+  }
+}
+
+AMXOpcode NegateRelation(AMXOpcode relation) {
+  switch (relation) {
+    case AMX_OP_SLESS: return AMX_OP_SGEQ;
+    case AMX_OP_SLEQ:  return AMX_OP_SGRTR;
+    case AMX_OP_SGRTR: return AMX_OP_SLEQ;
+    case AMX_OP_SGEQ:  return AMX_OP_SLESS;
+    default:           return AMX_OP_NONE;
+  }
+}
+
+// Turns a signed comparison of PRI with ALT into a comparison of the
+// variable with a number, if possible.
+bool GetRelation(AMXOpcode compare, const Range &range,
+                 AMXOpcode &relation, cell &number) {
+  if (range.pri.kind == Value::VARIABLE && range.alt.kind == Value::NUMBER) {
+    relation = compare;
+    number = range.alt.number;
+    return true;
+  }
+  if (range.pri.kind == Value::NUMBER && range.alt.kind == Value::VARIABLE) {
+    relation = SwapRelation(compare);
+    number = range.pri.number;
+    return true;
+  }
+  return false;
+}
+
+// Narrows the range to the values for which the relation holds (or not).
+// Returns false if there are no such values.
+bool Restrict(Range &range, AMXOpcode relation, cell number, bool holds) {
+  if (!holds) {
+    relation = NegateRelation(relation);
+  }
+  switch (relation) {
+    case AMX_OP_SLESS:
+      if (number == kMinCell) {
+        return false;
+      }
+      range.max = std::min(range.max, number - 1);
+      break;
+    case AMX_OP_SLEQ:
+      range.max = std::min(range.max, number);
+      break;
+    case AMX_OP_SGRTR:
+      if (number == kMaxCell) {
+        return false;
+      }
+      range.min = std::max(range.min, number + 1);
+      break;
+    case AMX_OP_SGEQ:
+      range.min = std::max(range.min, number);
+      break;
+    default:
+      break;
+  }
+  return range.min <= range.max;
+}
+
+// Forgets what PRI and ALT had to do with the variable once it changes.
+void Forget(Range &range) {
+  if (range.pri.kind == Value::VARIABLE
+      || range.pri.kind == Value::COMPARISON) {
+    range.pri = MakeValue(Value::UNKNOWN);
+  }
+  if (range.alt.kind == Value::VARIABLE
+      || range.alt.kind == Value::COMPARISON) {
+    range.alt = MakeValue(Value::UNKNOWN);
+  }
+}
+
+// Stores a value into the variable.
+void Assign(Range &range, const Value &value) {
+  if (value.kind == Value::VARIABLE) {
+    return;
+  }
+  if (value.kind == Value::NUMBER) {
+    range.min = value.number;
+    range.max = value.number;
+  } else {
+    range.min = kMinCell;
+    range.max = kMaxCell;
+  }
+  Forget(range);
+}
+
+// Adds 1 or -1 to the variable.
+void Increment(Range &range, cell delta) {
+  if ((delta > 0 && range.max == kMaxCell)
+      || (delta < 0 && range.min == kMinCell)) {
+    Assign(range, MakeValue(Value::UNKNOWN)); // may wrap around
+    return;
+  }
+  range.min += delta;
+  range.max += delta;
+  Forget(range);
+}
+
+// Merges a range coming from another path into the target range. Returns
+// true if the target range has changed.
+bool Merge(Range &target, const Range &range,
+           const std::set<cell> &thresholds) {
+  bool widen = target.updates >= kMaxRangeUpdates;
+  bool changed = false;
+  if (range.min < target.min) {
+    target.min = range.min;
+    if (widen) {
+      std::set<cell>::const_iterator it = thresholds.upper_bound(range.min);
+      target.min = it != thresholds.begin() ? *--it : kMinCell;
+    }
+    changed = true;
+  }
+  if (range.max > target.max) {
+    target.max = range.max;
+    if (widen) {
+      std::set<cell>::const_iterator it = thresholds.lower_bound(range.max);
+      target.max = it != thresholds.end() ? *it : kMaxCell;
+    }
+    changed = true;
+  }
+  if (target.pri.kind != Value::UNKNOWN && !(target.pri == range.pri)) {
+    target.pri = MakeValue(Value::UNKNOWN);
+    changed = true;
+  }
+  if (target.alt.kind != Value::UNKNOWN && !(target.alt == range.alt)) {
+    target.alt = MakeValue(Value::UNKNOWN);
+    changed = true;
+  }
+  if (changed) {
+    target.updates++;
+  }
+  return changed;
+}
+
+} // anonymous namespace
+
+AMXVerifier::AMXVerifier(AMXScript amx)
+ : amx_(amx),
+   code_size_(0),
+   error_address_(0)
+{
+}
+
+bool AMXVerifier::Verify() {
+  const AMX_HEADER *hdr = amx_.GetHeader();
+  code_size_ = hdr->dat - hdr->cod;
+
+  instrs_.clear();
+  functions_.clear();
+  index_.assign(code_size_ / sizeof(cell) + 1, -1);
+
+  AMXDisassembler disas(amx_);
+  AMXInstruction instr;
+  bool error = false;
+
+  while (disas.Decode(instr, &error)) {
+    index_[instr.address() / sizeof(cell)] = static_cast<int>(instrs_.size());
+    instrs_.push_back(instr);
+  }
+  if (error) {
+    return Fail(disas.ip(), "invalid instruction");
+  }
+  stack_.assign(instrs_.size(), -1);
+
+  for (std::vector<AMXInstruction>::const_iterator it = instrs_.begin();
+       it != instrs_.end(); it++) {
+    if (!CheckOperands(*it)) {
+      return false;
+    }
+  }
+
+  for (int i = 0; i < amx_.GetNumPublics(); i++) {
+    cell address = amx_.GetPublicAddress(i);
+    if (!IsInstruction(address)) {
+      return Fail(address, "public function starts at an invalid address");
+    }
+  }
+  if (hdr->cip >= 0 && !IsInstruction(hdr->cip)) {
+    return Fail(hdr->cip, "main() starts at an invalid address");
+  }
+
+  // Everything between two PROCs is considered one function.
+  for (std::vector<AMXInstruction>::const_iterator it = instrs_.begin();
+       it != instrs_.end(); it++) {
+    if (it->opcode() == AMX_OP_PROC) {
+      Function func;
+      func.address = it->address();
+      func.end = code_size_;
+      func.balanced = false;
+      func.uses_ret = false;
+      func.touches_frame = false;
+      func.entered_midway = false;
+      func.own_usage = 0;
+      func.total_usage = -1;
+      func.state = 0;
+      if (!functions_.empty()) {
+        functions_.back().end = func.address;
+      }
+      functions_.push_back(func);
+    }
+  }
+
+  // Jumps from other functions into the middle of a function make it
+  // impossible to follow its stack.
+  for (std::vector<AMXInstruction>::const_iterator it = instrs_.begin();
+       it != instrs_.end(); it++) {
+    Function *source = FindFunction(it->address());
+    if (source != 0) {
+      if (it->opcode() == AMX_OP_RET) {
+        source->uses_ret = true;
+      }
+      if (TouchesFrame(*it)) {
+        source->touches_frame = true;
+      }
+    }
+    for (int i = 0; i < it->num_operands(); i++) {
+      if (it->IsCodeAddressOperand(i)) {
+        Function *target = FindFunction(it->operand(i));
+        if (target != 0 && target != source
+            && target->address != it->operand(i)) {
+          target->entered_midway = true;
+        }
+      }
+    }
+  }
+  for (int i = 0; i < amx_.GetNumPublics(); i++) {
+    cell address = amx_.GetPublicAddress(i);
+    Function *func = FindFunction(address);
+    if (func != 0 && func->address != address) {
+      func->entered_midway = true;
+    }
+  }
+
+  for (std::vector<Function>::iterator it = functions_.begin();
+       it != functions_.end(); it++) {
+    AnalyzeFunction(*it);
+  }
+
+  // Calls were assumed to remove exactly their arguments from the stack,
+  // which only holds if the callee is balanced too.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::vector<Function>::iterator it = functions_.begin();
+         it != functions_.end(); it++) {
+      if (it->balanced && !AreCalleesBalanced(*it)) {
+        it->balanced = false;
+        changed = true;
+      }
+    }
+  }
+  for (std::size_t i = 0; i < instrs_.size(); i++) {
+    if (!IsBalanced(instrs_[i].address())) {
+      stack_[i] = -1;
+    }
+  }
+
+  return true;
+}
+
+bool AMXVerifier::IsBalanced(cell address) const {
+  const Function *func = FindFunction(address);
+  return func != 0 && func->balanced;
+}
+
+cell AMXVerifier::GetMaxUsage(cell address) const {
+  const Function *func = FindFunction(address);
+  if (func == 0 || func->address != address) {
+    return -1;
+  }
+  return GetTotalUsage(*func);
+}
+
+void AMXVerifier::FindRedundantBoundsChecks(
+  std::vector<cell> &addresses) const
+{
+  for (std::vector<Function>::const_iterator func = functions_.begin();
+       func != functions_.end(); func++) {
+    if (!func->balanced) {
+      continue;
+    }
+
+    // Variables used as array indexes, except those whose address is taken
+    // (they could be changed anywhere). Once the address of any local is
+    // passed to another function, that function may write past its end and
+    // change any other local as well.
+    std::set<cell> variables;
+    std::set<cell> excluded;
+    bool address_taken = false;
+    bool calls = false;
+
+    int first = index_[func->address / sizeof(cell)];
+    for (int i = first; i < static_cast<int>(instrs_.size())
+         && instrs_[i].address() < func->end; i++) {
+      const AMXInstruction &instr = instrs_[i];
+      switch (instr.opcode()) {
+        case AMX_OP_BOUNDS:
+          if (i > first && instrs_[i - 1].opcode() == AMX_OP_LOAD_S_PRI
+              && stack_[i] >= 0) {
+            variables.insert(instrs_[i - 1].operand());
+          }
+          break;
+        case AMX_OP_ADDR_PRI:
+        case AMX_OP_ADDR_ALT:
+        case AMX_OP_PUSH_ADR:
+          excluded.insert(instr.operand());
+          address_taken = true;
+          break;
+        case AMX_OP_CALL:
+        case AMX_OP_CALL_PRI:
+        case AMX_OP_SYSREQ_PRI:
+        case AMX_OP_SYSREQ_C:
+        case AMX_OP_SYSREQ_D:
+        case AMX_OP_SYSREQ_N:
+          calls = true;
+          break;
+        default:
+          break;
+      }
+    }
+    if (address_taken && calls) {
+      continue;
+    }
+
+    for (std::set<cell>::const_iterator it = variables.begin();
+         it != variables.end(); it++) {
+      if (excluded.find(*it) == excluded.end()) {
+        FindRedundantBoundsChecks(*func, *it, addresses);
+      }
+    }
+  }
+
+  std::sort(addresses.begin(), addresses.end());
+}
+
+bool AMXVerifier::Fail(cell address, const std::string &error) {
+  error_address_ = address;
+  error_ = error;
+  return false;
+}
+
+bool AMXVerifier::CheckOperands(const AMXInstruction &instr) {
+  for (int i = 0; i < instr.num_operands(); i++) {
+    if (instr.IsCodeAddressOperand(i)) {
+      const AMXInstruction *target = GetInstruction(instr.operand(i));
+      if (target == 0) {
+        return Fail(instr.address(), "jump to an invalid address");
+      }
+      if (target->opcode() == AMX_OP_CASETBL
+          && instr.opcode() != AMX_OP_SWITCH) {
+        return Fail(instr.address(), "jump into a case table");
+      }
+    }
+  }
+
+  switch (instr.opcode()) {
+    case AMX_OP_SWITCH:
+      if (GetInstruction(instr.operand())->opcode() != AMX_OP_CASETBL) {
+        return Fail(instr.address(), "switch without a case table");
+      }
+      break;
+    case AMX_OP_SYSREQ_C:
+      if (instr.operand() < 0 || instr.operand() >= amx_.GetNumNatives()) {
+        return Fail(instr.address(), "invalid native function index");
+      }
+      break;
+    default:
+      break;
+  }
+
+  return true;
+}
+
+bool AMXVerifier::IsInstruction(cell address) const {
+  return GetInstruction(address) != 0;
+}
+
+const AMXInstruction *AMXVerifier::GetInstruction(cell address) const {
+  if (address < 0 || address >= code_size_ || address % kCellSize != 0) {
+    return 0;
+  }
+  int index = index_[address / sizeof(cell)];
+  if (index < 0) {
+    return 0;
+  }
+  return &instrs_[index];
+}
+
+// static
+bool AMXVerifier::TouchesFrame(const AMXInstruction &instr) {
+  switch (instr.opcode()) {
+    case AMX_OP_LCTRL:
+    case AMX_OP_SCTRL:
+      return instr.operand() == 4 || instr.operand() == 5; // STK or FRM
+    // The previous frame, the return address and the size of the arguments
+    // are at FRM, FRM + 4 and FRM + 8.
+    case AMX_OP_STOR_S_PRI:
+    case AMX_OP_STOR_S_ALT:
+    case AMX_OP_ZERO_S:
+    case AMX_OP_INC_S:
+    case AMX_OP_DEC_S:
+    case AMX_OP_ADDR_PRI:
+    case AMX_OP_ADDR_ALT:
+    case AMX_OP_PUSH_ADR:
+      return instr.operand() >= 0 && instr.operand() <= 2 * kCellSize;
+    default:
+      return false;
+  }
+}
+
+bool AMXVerifier::AreCalleesBalanced(const Function &func) const {
+  for (std::vector<std::pair<cell, cell> >::const_iterator it =
+         func.calls.begin(); it != func.calls.end(); it++) {
+    const Function *callee = FindFunction(it->second);
+    if (callee == 0 || !callee->balanced) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void AMXVerifier::AnalyzeFunction(Function &func) {
+  if (func.entered_midway || func.touches_frame) {
+    return;
+  }
+
+  int first = index_[func.address / sizeof(cell)];
+  int last = first;
+  while (last < static_cast<int>(instrs_.size())
+         && instrs_[last].address() < func.end) {
+    last++;
+  }
+
+  State initial = {0, 0, false};
+  std::vector<State> states(last - first, initial);
+  std::vector<int> worklist;
+  std::vector<cell> next;
+
+  states[0].visited = true;
+  worklist.push_back(first);
+
+  cell max_stack = 0;
+  cell max_heap = 0;
+
+  while (!worklist.empty()) {
+    int i = worklist.back();
+    worklist.pop_back();
+
+    const AMXInstruction &instr = instrs_[i];
+    State state = states[i - first];
+    bool falls_through = true;
+    next.clear();
+
+    switch (instr.opcode()) {
+      case AMX_OP_PROC:
+        if (i != first) {
+          return;
+        }
+        state.stack += kCellSize;
+        break;
+      case AMX_OP_PUSH_PRI:
+      case AMX_OP_PUSH_ALT:
+      case AMX_OP_PUSH_C:
+      case AMX_OP_PUSH:
+      case AMX_OP_PUSH_S:
+      case AMX_OP_PUSH_ADR:
+        state.stack += kCellSize;
+        break;
+      case AMX_OP_PAMX_OP_PRI:
+      case AMX_OP_PAMX_OP_ALT:
+        state.stack -= kCellSize;
+        break;
+      case AMX_OP_STACK:
+        state.stack -= instr.operand();
+        break;
+      case AMX_OP_HEAP:
+        state.heap += instr.operand();
+        break;
+      case AMX_OP_CALL: {
+        // The callee removes its arguments along with their size, which
+        // must come from a preceding PUSH.C.
+        const Function *callee = FindFunction(instr.operand());
+        if (i == first || instrs_[i - 1].opcode() != AMX_OP_PUSH_C
+            || callee == 0 || callee->address != instr.operand()
+            || callee->uses_ret) {
+          return;
+        }
+        cell args_size = instrs_[i - 1].operand() + kCellSize;
+        if (args_size <= 0 || args_size % kCellSize != 0
+            || args_size > state.stack - kCellSize) {
+          return;
+        }
+        func.calls.push_back(std::make_pair(
+          state.stack + state.heap + kCellSize,
+          callee->address));
+        state.stack -= args_size;
+        break;
+      }
+      case AMX_OP_SCTRL:
+        switch (instr.operand()) {
+          case 2: // HEA
+          case 4: // STK
+          case 5: // FRM
+          case 6: // CIP
+            return;
+        }
+        break;
+      case AMX_OP_CALL_PRI:
+      case AMX_OP_JUMP_PRI:
+      case AMX_OP_JREL:
+      case AMX_OP_PUSH_R:
+      case AMX_OP_CASETBL:
+        return;
+      case AMX_OP_RET:
+      case AMX_OP_RETN:
+        if (state.stack != kCellSize || state.heap != 0) {
+          return;
+        }
+        falls_through = false;
+        break;
+      case AMX_OP_HALT:
+        falls_through = false;
+        break;
+      case AMX_OP_JUMP:
+        next.push_back(instr.operand());
+        falls_through = false;
+        break;
+      case AMX_OP_SWITCH: {
+        const AMXInstruction *casetbl = GetInstruction(instr.operand());
+        for (int k = 1; k < casetbl->num_operands(); k += 2) {
+          next.push_back(casetbl->operand(k));
+        }
+        falls_through = false;
+        break;
+      }
+      default: {
+        // Conditional jumps.
+        const AMXOpcodeInfo *info = GetAmxOpcodeInfo(instr.opcode());
+        if (info->is_jump) {
+          next.push_back(instr.operand());
+        }
+        break;
+      }
+    }
+
+    if (state.stack < kCellSize || state.heap < 0) {
+      return;
+    }
+    max_stack = std::max(max_stack, state.stack);
+    max_heap = std::max(max_heap, state.heap);
+
+    if (falls_through) {
+      next.push_back(instr.address() + instr.size());
+    }
+    for (std::vector<cell>::const_iterator it = next.begin();
+         it != next.end(); it++) {
+      if (*it < func.address || *it >= func.end) {
+        return;
+      }
+      int j = index_[*it / sizeof(cell)];
+      State &target = states[j - first];
+      if (!target.visited) {
+        target = state;
+        target.visited = true;
+        worklist.push_back(j);
+      } else if (target.stack != state.stack || target.heap != state.heap) {
+        return;
+      }
+    }
+  }
+
+  func.balanced = true;
+  func.own_usage = max_stack + max_heap;
+
+  for (int i = first; i < last; i++) {
+    if (states[i - first].visited) {
+      stack_[i] = states[i - first].stack;
+    }
+  }
+}
+
+AMXVerifier::Function *AMXVerifier::FindFunction(cell address) {
+  return const_cast<Function*>(
+    static_cast<const AMXVerifier*>(this)->FindFunction(address));
+}
+
+const AMXVerifier::Function *AMXVerifier::FindFunction(cell address) const {
+  std::vector<Function>::const_iterator it = functions_.begin();
+  std::vector<Function>::const_iterator end = functions_.end();
+  while (it != end) {
+    std::vector<Function>::const_iterator mid = it + (end - it) / 2;
+    if (mid->address <= address) {
+      it = mid + 1;
+    } else {
+      end = mid;
+    }
+  }
+  if (it == functions_.begin()) {
+    return 0;
+  }
+  --it;
+  if (address >= it->end) {
+    return 0;
+  }
+  return &*it;
+}
+
+cell AMXVerifier::GetTotalUsage(const Function &func) const {
+  if (func.state == 2) {
+    return func.total_usage;
+  }
+  if (func.state == 1) {
+    return -1; // recursion
+  }
+
+  func.state = 1;
+  cell total = func.balanced ? func.own_usage : -1;
+
+  for (std::vector<std::pair<cell, cell> >::const_iterator it =
+         func.calls.begin(); it != func.calls.end() && total >= 0; it++) {
+    cell usage = GetTotalUsage(*FindFunction(it->second));
+    if (usage < 0) {
+      total = -1;
+    } else {
+      total = std::max(total, it->first + usage);
+    }
+  }
+
+  func.state = 2;
+  func.total_usage = total;
+  return total;
+}
+
+void AMXVerifier::FindRedundantBoundsChecks(
+  const Function &func,
+  cell variable,
+  std::vector<cell> &addresses) const
+{
+  int first = index_[func.address / sizeof(cell)];
+  int last = first;
+  while (last < static_cast<int>(instrs_.size())
+         && instrs_[last].address() < func.end) {
+    last++;
+  }
+
+  Range initial = {
+    kMinCell,
+    kMaxCell,
+    MakeValue(Value::UNKNOWN),
+    MakeValue(Value::UNKNOWN),
+    false,
+    0
+  };
+  std::vector<Range> ranges(last - first, initial);
+  std::vector<int> worklist;
+  std::vector<std::pair<cell, Range> > next;
+
+  std::set<cell> thresholds;
+  thresholds.insert(-1);
+  thresholds.insert(0);
+  for (int i = first; i < last; i++) {
+    AMXOpcode opcode = instrs_[i].opcode();
+    if (opcode == AMX_OP_CONST_PRI || opcode == AMX_OP_CONST_ALT) {
+      cell number = instrs_[i].operand();
+      thresholds.insert(number);
+      if (number > kMinCell) {
+        thresholds.insert(number - 1);
+      }
+    }
+  }
+
+  ranges[0].visited = true;
+  worklist.push_back(first);
+
+  while (!worklist.empty()) {
+    int i = worklist.back();
+    worklist.pop_back();
+
+    const AMXInstruction &instr = instrs_[i];
+    Range range = ranges[i - first];
+    cell stack = stack_[i];
+    bool falls_through = true;
+    next.clear();
+
+    // Cells below the top of the stack are free and may be overwritten by
+    // calls, and they contain garbage once allocated again.
+    if (variable < kCellSize - stack) {
+      Assign(range, MakeValue(Value::UNKNOWN));
+    }
+
+    switch (instr.opcode()) {
+      case AMX_OP_LOAD_S_PRI:
+        range.pri = MakeValue(instr.operand() == variable ? Value::VARIABLE
+                                                          : Value::UNKNOWN);
+        break;
+      case AMX_OP_LOAD_S_ALT:
+        range.alt = MakeValue(instr.operand() == variable ? Value::VARIABLE
+                                                          : Value::UNKNOWN);
+        break;
+      case AMX_OP_CONST_PRI:
+        range.pri = MakeValue(Value::NUMBER, instr.operand());
+        break;
+      case AMX_OP_CONST_ALT:
+        range.alt = MakeValue(Value::NUMBER, instr.operand());
+        break;
+      case AMX_OP_ZERO_PRI:
+        range.pri = MakeValue(Value::NUMBER, 0);
+        break;
+      case AMX_OP_ZERO_ALT:
+        range.alt = MakeValue(Value::NUMBER, 0);
+        break;
+      case AMX_OP_MOVE_PRI:
+        range.pri = range.alt;
+        break;
+      case AMX_OP_MOVE_ALT:
+        range.alt = range.pri;
+        break;
+      case AMX_OP_XCHG:
+        std::swap(range.pri, range.alt);
+        break;
+      case AMX_OP_STOR_S_PRI:
+        if (instr.operand() == variable) {
+          Assign(range, range.pri);
+        }
+        break;
+      case AMX_OP_STOR_S_ALT:
+        if (instr.operand() == variable) {
+          Assign(range, range.alt);
+        }
+        break;
+      case AMX_OP_ZERO_S:
+        if (instr.operand() == variable) {
+          Assign(range, MakeValue(Value::NUMBER, 0));
+        }
+        break;
+      case AMX_OP_INC_S:
+        if (instr.operand() == variable) {
+          Increment(range, 1);
+        }
+        break;
+      case AMX_OP_DEC_S:
+        if (instr.operand() == variable) {
+          Increment(range, -1);
+        }
+        break;
+      // A push writes to the cell at -stack relative to FRM.
+      case AMX_OP_PUSH_PRI:
+        if (-stack == variable) {
+          Assign(range, range.pri);
+        }
+        break;
+      case AMX_OP_PUSH_ALT:
+        if (-stack == variable) {
+          Assign(range, range.alt);
+        }
+        break;
+      case AMX_OP_PUSH_C:
+        if (-stack == variable) {
+          Assign(range, MakeValue(Value::NUMBER, instr.operand()));
+        }
+        break;
+      case AMX_OP_PUSH:
+      case AMX_OP_PUSH_S:
+      case AMX_OP_PUSH_ADR:
+        if (-stack == variable) {
+          Assign(range, MakeValue(Value::UNKNOWN));
+        }
+        break;
+      case AMX_OP_SWAP_PRI:
+      case AMX_OP_SWAP_ALT: {
+        Value &reg = instr.opcode() == AMX_OP_SWAP_PRI ? range.pri
+                                                        : range.alt;
+        if (kCellSize - stack == variable) {
+          if (reg.kind != Value::VARIABLE) {
+            Value value = reg;
+            reg = MakeValue(Value::UNKNOWN);
+            Assign(range, value);
+          }
+        } else {
+          reg = MakeValue(Value::UNKNOWN);
+        }
+        break;
+      }
+      case AMX_OP_STACK:
+      case AMX_OP_HEAP:
+        range.alt = MakeValue(Value::UNKNOWN);
+        break;
+      case AMX_OP_SLESS:
+      case AMX_OP_SLEQ:
+      case AMX_OP_SGRTR:
+      case AMX_OP_SGEQ: {
+        AMXOpcode relation;
+        cell number;
+        if (GetRelation(instr.opcode(), range, relation, number)) {
+          range.pri = MakeValue(Value::COMPARISON, number, relation);
+        } else {
+          range.pri = MakeValue(Value::UNKNOWN);
+        }
+        break;
+      }
+      case AMX_OP_JSLESS:
+      case AMX_OP_JSLEQ:
+      case AMX_OP_JSGRTR:
+      case AMX_OP_JSGEQ: {
+        static const AMXOpcode compare[] = {
+          AMX_OP_SLESS, AMX_OP_SLEQ, AMX_OP_SGRTR, AMX_OP_SGEQ
+        };
+        AMXOpcode relation;
+        cell number;
+        Range taken = range;
+        if (GetRelation(compare[instr.opcode() - AMX_OP_JSLESS], range,
+                        relation, number)) {
+          if (Restrict(taken, relation, number, true)) {
+            next.push_back(std::make_pair(instr.operand(), taken));
+          }
+          if (!Restrict(range, relation, number, false)) {
+            falls_through = false;
+          }
+        } else {
+          next.push_back(std::make_pair(instr.operand(), taken));
+        }
+        break;
+      }
+      case AMX_OP_JZER:
+      case AMX_OP_JNZ: {
+        Range taken = range;
+        if (range.pri.kind == Value::COMPARISON) {
+          bool holds = instr.opcode() == AMX_OP_JNZ;
+          if (Restrict(taken, range.pri.relation, range.pri.number, holds)) {
+            next.push_back(std::make_pair(instr.operand(), taken));
+          }
+          if (!Restrict(range, range.pri.relation, range.pri.number,
+                        !holds)) {
+            falls_through = false;
+          }
+        } else {
+          next.push_back(std::make_pair(instr.operand(), taken));
+        }
+        break;
+      }
+      case AMX_OP_JEQ:
+      case AMX_OP_JNEQ:
+      case AMX_OP_JLESS:
+      case AMX_OP_JLEQ:
+      case AMX_OP_JGRTR:
+      case AMX_OP_JGEQ:
+        next.push_back(std::make_pair(instr.operand(), range));
+        break;
+      case AMX_OP_JUMP:
+        next.push_back(std::make_pair(instr.operand(), range));
+        falls_through = false;
+        break;
+      case AMX_OP_SWITCH: {
+        const AMXInstruction *casetbl = GetInstruction(instr.operand());
+        for (int k = 1; k < casetbl->num_operands(); k += 2) {
+          next.push_back(std::make_pair(casetbl->operand(k), range));
+        }
+        falls_through = false;
+        break;
+      }
+      case AMX_OP_RET:
+      case AMX_OP_RETN:
+      case AMX_OP_HALT:
+        falls_through = false;
+        break;
+      // These don't change PRI, ALT or local variables.
+      case AMX_OP_PROC:
+      case AMX_OP_BOUNDS:
+      case AMX_OP_STOR_PRI:
+      case AMX_OP_STOR_ALT:
+      case AMX_OP_ZERO:
+      case AMX_OP_INC:
+      case AMX_OP_DEC:
+      case AMX_OP_FILE:
+      case AMX_OP_LINE:
+      case AMX_OP_SYMBOL:
+      case AMX_OP_SRANGE:
+      case AMX_OP_SYMTAG:
+      case AMX_OP_NOP:
+      case AMX_OP_BREAK:
+        break;
+      default:
+        range.pri = MakeValue(Value::UNKNOWN);
+        range.alt = MakeValue(Value::UNKNOWN);
+        break;
+    }
+
+    if (falls_through) {
+      next.push_back(std::make_pair(instr.address() + instr.size(), range));
+    }
+    for (std::vector<std::pair<cell, Range> >::const_iterator it =
+           next.begin(); it != next.end(); it++) {
+      int j = index_[it->first / sizeof(cell)];
+      Range &target = ranges[j - first];
+      if (!target.visited) {
+        target = it->second;
+        target.visited = true;
+        target.updates = 0;
+        worklist.push_back(j);
+      } else if (Merge(target, it->second, thresholds)) {
+        worklist.push_back(j);
+      }
+    }
+  }
+
+  for (int i = first + 1; i < last; i++) {
+    const AMXInstruction &instr = instrs_[i];
+    const Range &range = ranges[i - first];
+    if (instr.opcode() == AMX_OP_BOUNDS
+        && instrs_[i - 1].opcode() == AMX_OP_LOAD_S_PRI
+        && instrs_[i - 1].operand() == variable
+        && range.visited
+        && range.pri.kind == Value::VARIABLE
+        && range.min >= 0
+        && range.max <= instr.operand()) {
+      addresses.push_back(instr.address());
+    }
+  }
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef AMXVERIFIER_H
+#define AMXVERIFIER_H
+
+#include <string>
+#include <vector>
+
+#include <amx/amx.h>
+
+#include "amxdisasm.h"
+#include "amxscript.h"
+
+// AMXVerifier checks the code of a loaded script before it's run: every
+// opcode must be valid, jumps and calls must land on instructions and native
+// indexes must be in range. It then follows the stack and the heap
+// through each function to see whether they are balanced and how much of
+// them the function (and everything it calls) may use. Finally, it can
+// follow the values of local variables to find array bounds checks that
+// are redundant.
+class AMXVerifier {
+ public:
+  explicit AMXVerifier(AMXScript amx);
+
+  // Returns false if the code is malformed, error() and error_address()
+  // then tell what's wrong and where.
+  bool Verify();
+
+  const std::string &error() const { return error_; }
+  cell error_address() const { return error_address_; }
+
+  // Returns true if the instruction at the given address belongs to a
+  // function that never releases more stack or heap than it has allocated,
+  // doesn't touch STK, FRM or its own frame header and calls only such
+  // functions.
+  bool IsBalanced(cell address) const;
+
+  // Returns the maximum number of bytes of stack and heap the function at
+  // the given address may use, including the functions it calls, or -1 if
+  // it's not known (e.g. because of recursion or indirect calls).
+  cell GetMaxUsage(cell address) const;
+
+  // Finds BOUNDS instructions that can never fail because the index is a
+  // local variable whose value is always in range at that point, such as
+  // the counter of a simple for loop. Only balanced functions are analyzed.
+  // Memory is assumed to be modified only by the function's own instructions
+  // and through checked array indexes, so variables whose address is taken
+  // are left alone, and so are functions that pass the address of a local
+  // to a call.
+  void FindRedundantBoundsChecks(std::vector<cell> &addresses) const;
+
+ private:
+  struct Function {
+    cell address;
+    cell end;
+    bool balanced;
+    bool uses_ret;
+    bool touches_frame;
+    bool entered_midway;
+    cell own_usage;
+    std::vector<std::pair<cell, cell> > calls; // usage at call site, target
+    mutable cell total_usage;
+    mutable int state;
+  };
+
+  bool Fail(cell address, const std::string &error);
+
+  bool CheckOperands(const AMXInstruction &instr);
+  bool IsInstruction(cell address) const;
+  const AMXInstruction *GetInstruction(cell address) const;
+
+  static bool TouchesFrame(const AMXInstruction &instr);
+  bool AreCalleesBalanced(const Function &func) const;
+
+  void AnalyzeFunction(Function &func);
+  Function *FindFunction(cell address);
+  const Function *FindFunction(cell address) const;
+  cell GetTotalUsage(const Function &func) const;
+  void FindRedundantBoundsChecks(const Function &func, cell variable,
+                                 std::vector<cell> &addresses) const;
+
+ private:
+  AMXScript amx_;
+  cell code_size_;
+  std::vector<AMXInstruction> instrs_;
+  std::vector<int> index_; // instruction index by address / sizeof(cell)
+  std::vector<cell> stack_; // stack usage before each instruction or -1
+  std::vector<Function> functions_;
+  std::string error_;
+  cell error_address_;
+};
+
+#endif // !AMXVERIFIER_H
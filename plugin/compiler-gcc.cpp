@@ -22,6 +22,8 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include "compiler.h"
+
 #ifdef _WIN32
   #define SYMBOL(x) "_"x
 #else
@@ -145,3 +147,26 @@ __asm__ (
   "  ret\n"
 );
 #undef FUNC
+
+#define FUNC "ReadTimestampCounter"
+__asm__ (
+  BEGIN_GLOBAL("_ZN8compiler20ReadTimestampCounterEv")
+  "  rdtsc\n"
+  "  ret\n"
+);
+#undef FUNC
+
+namespace compiler {
+
+void StoreRelease(volatile int *ptr, int value) {
+  __sync_synchronize();
+  *ptr = value;
+}
+
+int LoadAcquire(const volatile int *ptr) {
+  int value = *ptr;
+  __sync_synchronize();
+  return value;
+}
+
+} // namespace compiler
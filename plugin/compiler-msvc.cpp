@@ -23,6 +23,9 @@
 // POSSIBILITY OF SUCH DAMAGE.
 
 #include <cstddef>
+#include <intrin.h>
+
+#include "cstdint.h"
 
 namespace compiler {
 
@@ -119,4 +122,22 @@ __declspec(naked) void *CallFunctionStdcall(void *func, const void *args, std::s
   __asm ret
 }
 
+__declspec(naked) std::uint64_t ReadTimestampCounter() {
+  __asm rdtsc
+  __asm ret
+}
+
+// On x86 ordinary stores and loads already have release and acquire
+// semantics, we only need to keep the compiler from reordering them.
+void StoreRelease(volatile int *ptr, int value) {
+  _ReadWriteBarrier();
+  *ptr = value;
+}
+
+int LoadAcquire(const volatile int *ptr) {
+  int value = *ptr;
+  _ReadWriteBarrier();
+  return value;
+}
+
 } // namespace compiler
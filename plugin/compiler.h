@@ -27,6 +27,8 @@
 
 #include <cstddef>
 
+#include "cstdint.h"
+
 namespace compiler {
 
 void *GetStackFrame(int depth = 0);
@@ -37,6 +39,15 @@ void *GetReturnAddress(void *frame = 0, int depth = 0);
 void *CallFunctionCdecl(void *func, const void *args, std::size_t size);
 void *CallFunctionStdcall(void *func, const void *args, std::size_t size);
 
+std::uint64_t ReadTimestampCounter();
+
+// Store a flag so that everything written before becomes visible to other
+// threads no later than the flag itself, and load it so that nothing is read
+// ahead of it. This is enough to hand data over to another thread without
+// locking.
+void StoreRelease(volatile int *ptr, int value);
+int LoadAcquire(const volatile int *ptr);
+
 } // namespace compiler
 
 #endif // !COMPILER_H
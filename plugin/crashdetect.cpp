@@ -22,6 +22,7 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
 #include <cassert>
 #include <cstdarg>
 #include <cstdlib>
@@ -32,14 +33,21 @@
 #include <string>
 
 #include "amxdebuginfo.h"
+#include "amxdisasm.h"
 #include "amxerror.h"
 #include "amxopcode.h"
+#include "amxoptimizer.h"
 #include "amxpathfinder.h"
 #include "amxscript.h"
+#include "amxscriptindex.h"
 #include "amxstacktrace.h"
+#include "amxverifier.h"
 #include "compiler.h"
+#include "configreader.h"
 #include "crashdetect.h"
+#include "crashdump.h"
 #include "fileutils.h"
+#include "flightrecorder.h"
 #include "logprintf.h"
 #include "npcall.h"
 #include "os.h"
@@ -47,7 +55,20 @@
 
 #define AMX_EXEC_GDK (-10)
 
+bool CrashDetect::enabled_ = true;
 bool CrashDetect::block_exec_errors_ = false;
+bool CrashDetect::raw_backtrace_ = false;
+bool CrashDetect::superinstructions_ = false;
+bool CrashDetect::direct_natives_ = false;
+bool CrashDetect::verify_ = true;
+bool CrashDetect::elide_stack_checks_ = false;
+bool CrashDetect::elide_bounds_ = false;
+bool CrashDetect::elide_breaks_ = false;
+bool CrashDetect::print_load_times_ = false;
+bool CrashDetect::foreign_exec_ = false;
+std::uint64_t CrashDetect::plugin_load_times_[kNumLoadPhases];
+AMXPathFinder CrashDetect::path_finder_;
+AMXDebugInfoPreloader CrashDetect::debug_info_preloader_;
 std::stack<NPCall*> CrashDetect::np_calls_;
 
 namespace {
@@ -69,15 +90,109 @@ class HexDword {
   uint32_t value_;
 };
 
+// Gives read-only access to the container underlying a std::stack so that
+// it can be walked without making a copy, e.g. from a signal handler.
+template<typename Stack>
+const typename Stack::container_type &GetStackContainer(const Stack &stack) {
+  struct Accessor : Stack {
+    static const typename Stack::container_type &Get(const Stack &stack) {
+      return stack.*&Accessor::c;
+    }
+  };
+  return Accessor::Get(stack);
+}
+
+void PrintNativeFrame(std::ostream &stream, int &level, AMXScript amx,
+                      cell index) {
+  cell address = amx.GetNativeAddress(index);
+  if (address == 0) {
+    return;
+  }
+
+  stream << "#" << level++ << " native ";
+
+  const char *name = amx.GetNativeName(index);
+  if (name != 0) {
+    stream << name;
+  } else {
+    stream << "<unknown>";
+  }
+
+  char fill = stream.fill();
+  stream << " () [" << HexDword(address) << "]";
+  stream.fill(fill);
+
+  std::string path = os::GetModulePathFromAddr(reinterpret_cast<void*>(address));
+  std::string module = fileutils::GetFileName(path);
+  if (!module.empty()) {
+    stream << " from " << module;
+  }
+
+  stream << std::endl;
+}
+
+// Helper class for printing a time in microseconds as milliseconds.
+class Milliseconds {
+ public:
+  Milliseconds(std::uint64_t time): time_(time) {}
+  friend std::ostream &operator<<(std::ostream &stream,
+                                  const Milliseconds &ms) {
+    // Format it as a whole so that setw() applies to the entire number.
+    std::stringstream string;
+    string << ms.time_ / 1000 << '.'
+           << std::setw(3) << std::setfill('0') << ms.time_ % 1000;
+    return stream << string.str();
+  }
+ private:
+  std::uint64_t time_;
+};
+
+// Returns the time elapsed since start and moves start to the current time.
+std::uint64_t Lap(std::uint64_t &start) {
+  std::uint64_t now = os::GetMicroseconds();
+  std::uint64_t time = now - start;
+  start = now;
+  return time;
+}
+
+std::uint64_t GetTotalLoadTime(const std::uint64_t *times) {
+  std::uint64_t total = 0;
+  for (int i = 0; i < CrashDetect::kNumLoadPhases; i++) {
+    total += times[i];
+  }
+  return total;
+}
+
+int AMXAPI AmxCallback(AMX *amx, cell index, cell *result, cell *params) {
+  return CrashDetect::Get(amx)->DoAmxCallback(index, result, params);
+}
+
 } // anonymous namespace
 
 // static
 void CrashDetect::OnException(void *context) {
+  // Write the dump first: it doesn't need the heap, unlike everything below.
+  // Find() rather than Get(): the latter may allocate.
+  CrashDetect *top = 0;
   if (!np_calls_.empty()) {
-    CrashDetect::Get(np_calls_.top()->amx())->HandleException();
+    top = CrashDetect::Find(np_calls_.top()->amx());
+  }
+  if (CrashDump::IsOpen()) {
+    const char *amx_name = 0;
+    const std::vector<cell> *breaks = 0;
+    if (top != 0) {
+      amx_name = top->amx_name_.c_str();
+      breaks = &top->breaks_;
+    }
+    CrashDump::Write(context, GetStackContainer(np_calls_),
+                     amx_GetNativeCalls(), amx_name, breaks);
+  }
+  if (top != 0) {
+    top->HandleException();
   } else {
     Printf("Server crashed due to an unknown error");
   }
+  PrintFlightRecorder();
   PrintNativeBacktrace(context);
 }
 
@@ -156,13 +271,15 @@ void CrashDetect::PrintError(AMXScript amx, const AMXError &error) {
       break;
     case AMX_ERR_INVINSTR: {
       cell opcode = *(reinterpret_cast<const cell*>(amx.GetCode() + amx.GetCip()));
-      Printf(" Unknown opcode 0x%x at address 0x%08X", opcode , amx.GetCip());
+      cell address = AMXStackFramePrinter::GetOriginalAddress(
+        CrashDetect::Get(amx)->breaks_, amx.GetCip());
+      Printf(" Unknown opcode 0x%x at address 0x%08X", opcode , address);
       break;
     }
     case AMX_ERR_NATIVE: {
       const cell *ip = reinterpret_cast<const cell*>(amx.GetCode() + amx.GetCip());
       cell opcode = *(ip - 2);
-      if (opcode == RelocateAmxOpcode(AMX_OP_SYSREQ_C)) {
+      if (UnrelocateAmxOpcode(opcode) == AMX_OP_SYSREQ_C) {
         cell index = *(ip - 1);
         Printf(" %s", amx.GetNativeName(index));
       }
@@ -171,6 +288,89 @@ void CrashDetect::PrintError(AMXScript amx, const AMXError &error) {
   }
 }
 
+// static
+void CrashDetect::Configure(const ConfigReader &config) {
+  config.GetOption("crashdetect_enabled", enabled_);
+  config.GetOption("crashdetect_raw_backtrace", raw_backtrace_);
+  config.GetOption("crashdetect_superinstructions", superinstructions_);
+  config.GetOption("crashdetect_direct_natives", direct_natives_);
+  config.GetOption("crashdetect_verify", verify_);
+  config.GetOption("crashdetect_elide_stack_checks", elide_stack_checks_);
+  config.GetOption("crashdetect_elide_bounds", elide_bounds_);
+  config.GetOption("crashdetect_elide_breaks", elide_breaks_);
+  config.GetOption("crashdetect_load_times", print_load_times_);
+  FlightRecorder::Init(
+    config.GetOptionDefault<std::size_t>("crashdetect_flight_recorder", 32),
+    config.GetOptionDefault("crashdetect_flight_recorder_args", 0));
+
+  path_finder_.AddSearchPath("gamemodes");
+  path_finder_.AddSearchPath("filterscripts");
+  path_finder_.AddSearchPath("npcmodes");
+
+  std::string symbol_path;
+  config.GetOption("crashdetect_symbol_path", symbol_path);
+  if (!symbol_path.empty()) {
+    path_finder_.AddSearchPath(symbol_path);
+  }
+
+  // Read a list of additional search paths from AMX_PATH.
+  const char *AMX_PATH = getenv("AMX_PATH");
+  if (AMX_PATH != 0) {
+    std::string var(AMX_PATH);
+    std::string path;
+    std::string::size_type begin = 0;
+    while (begin < var.length()) {
+      std::string::size_type end = var.find(fileutils::kNativePathListSepChar, begin);
+      if (end == std::string::npos) {
+        end = var.length();
+      }
+      path.assign(var.begin() + begin, var.begin() + end);
+      if (!path.empty()) {
+        path_finder_.AddSearchPath(path);
+      }
+      begin = end + 1;
+    }
+  }
+
+  std::uint64_t scan_start = os::GetMicroseconds();
+  std::vector<std::string> debug_info_files;
+  std::size_t num_files = path_finder_.Preload(debug_info_files);
+  std::uint64_t scan_time = os::GetMicroseconds() - scan_start;
+  logprintf("  Scanned %d script files in %d.%03d ms.",
+            static_cast<int>(num_files),
+            static_cast<int>(scan_time / 1000),
+            static_cast<int>(scan_time % 1000));
+
+  // Scripts are loaded one after another, get their debug info ready in the
+  // meantime.
+  if (!raw_backtrace_ &&
+      config.GetOptionDefault("crashdetect_preload_debug_info", true)) {
+    debug_info_preloader_.Start(debug_info_files);
+  }
+}
+
+// static
+void CrashDetect::FinishStartup() {
+  // Debug info of scripts that haven't been loaded is not needed anymore.
+  debug_info_preloader_.Finish();
+}
+
+// static
+void CrashDetect::SetEnabled(bool enabled) {
+  if (enabled == enabled_) {
+    return;
+  }
+  enabled_ = enabled;
+  for (ServiceMap::const_iterator it = service_map_.begin();
+       it != service_map_.end(); it++) {
+    if (enabled) {
+      it->second->Attach();
+    } else {
+      it->second->Detach();
+    }
+  }
+}
+
 // static
 void CrashDetect::PrintAmxBacktrace() {
   std::stringstream stream;
@@ -190,9 +390,15 @@ void CrashDetect::PrintAmxBacktrace(std::ostream &stream) {
     return;
   }
 
-  stream << "AMX backtrace:\n";
+  if (raw_backtrace_) {
+    stream << "AMX backtrace (fingerprint "
+           << HexDword(CrashDetect::Get(top_amx)->fingerprint_) << "):\n";
+  } else {
+    stream << "AMX backtrace:\n";
+  }
 
   std::stack<NPCall*> np_calls = np_calls_;
+  const AMX_NATIVECALL *native_call = amx_GetNativeCalls();
 
   cell cip = top_amx.GetCip();
   cell frm = top_amx.GetFrm();
@@ -207,37 +413,25 @@ void CrashDetect::PrintAmxBacktrace(std::ostream &stream) {
       break;
     }
 
+    // natives called directly by the interpreter (SYSREQ.N)
+    for (; native_call != 0 && native_call != call->outer_native_calls();
+         native_call = native_call->prev) {
+      if (native_call->amx != top_amx.amx()) {
+        return;
+      }
+      PrintNativeFrame(stream, level, amx, native_call->index);
+    }
+
     // native function
     if (call->IsNative()) {
-      cell address = amx.GetNativeAddress(call->index());
-      if (address != 0) {
-        stream << "#" << level++ << " native ";
-
-        const char *name = amx.GetNativeName(call->index());
-        if (name != 0) {
-          stream << name;
-        } else {
-          stream << "<unknown>";
-        }
-
-        char fill = stream.fill();
-        stream << " () [" << HexDword(address) << "]";
-        stream.fill(fill);
-
-        std::string path = os::GetModulePathFromAddr(reinterpret_cast<void*>(address));
-        std::string module = fileutils::GetFileName(path);
-        if (!module.empty()) {
-          stream << " from " << module;
-        }
-
-        stream << std::endl;
-      }
+      PrintNativeFrame(stream, level, amx, call->index());
     }
 
     // public function
     else if (call->IsPublic()) {
       const AMXDebugInfo &debug_info = CrashDetect::Get(amx)->debug_info_;
       const std::string &amx_name = CrashDetect::Get(amx)->amx_name_;
+      const std::vector<cell> &breaks = CrashDetect::Get(amx)->breaks_;
 
       amx.PushStack(cip);
       amx.PushStack(frm);
@@ -266,8 +460,23 @@ void CrashDetect::PrintAmxBacktrace(std::ostream &stream) {
            it != frames.end(); it++) {
         const AMXStackFrame &frame = *it;
 
+        AMXStackFramePrinter printer;
+        printer.set_stream(&stream);
+        printer.set_at_instruction(level == 0);
+
         stream << "#" << level++ << " ";
-        frame.Print(stream, &debug_info);
+
+        if (raw_backtrace_) {
+          // Leave symbolization to the offline tool (amxsym).
+          printer.PrintReturnAddress(frame);
+          stream << " @" << HexDword(frame.caller_address());
+        } else {
+          printer.set_debug_info(&debug_info);
+          if (!breaks.empty()) {
+            printer.set_removed_breaks(&breaks);
+          }
+          printer.Print(frame);
+        }
 
         if (!debug_info.IsLoaded() && !amx_name.empty()) {
           stream << " from " << amx_name;
@@ -284,6 +493,100 @@ void CrashDetect::PrintAmxBacktrace(std::ostream &stream) {
   }
 }
 
+// static
+void CrashDetect::PrintFlightRecorder() {
+  std::stringstream stream;
+  PrintFlightRecorder(stream);
+  PrintLines(stream.str());
+}
+
+// static
+void CrashDetect::PrintFlightRecorder(std::ostream &stream) {
+  std::size_t num_entries = FlightRecorder::GetNumEntries();
+  if (num_entries == 0) {
+    return;
+  }
+
+  std::uint64_t now = compiler::ReadTimestampCounter();
+  double ticks_per_ms = FlightRecorder::GetTicksPerSecond() / 1000;
+
+  stream << "Last " << num_entries << " calls (most recent first):\n";
+
+  for (std::size_t i = 0; i < num_entries; i++) {
+    const FlightRecorder::Entry &entry = FlightRecorder::GetEntry(i);
+    CrashDetect *crashdetect = CrashDetect::Find(entry.amx);
+
+    stream << "#" << i << " ";
+
+    if (crashdetect == 0) {
+      stream << (entry.type == FlightRecorder::kNative ? "native" : "public")
+             << " #" << entry.index;
+    } else {
+      AMXScript amx = crashdetect->amx_;
+      const char *name = 0;
+      if (entry.type == FlightRecorder::kNative) {
+        stream << "native ";
+        name = amx.GetNativeName(entry.index);
+      } else if (entry.index == AMX_EXEC_MAIN) {
+        name = "main";
+      } else {
+        stream << "public ";
+        name = amx.GetPublicName(entry.index);
+      }
+      if (name != 0) {
+        stream << name;
+      } else {
+        stream << "<unknown>";
+      }
+    }
+
+    const cell *args = FlightRecorder::GetArgs(i);
+    if (entry.type == FlightRecorder::kNative && args != 0) {
+      AMXStackFramePrinter printer;
+      printer.set_stream(&stream);
+
+      int num_args = std::min(entry.num_args, FlightRecorder::max_args());
+      stream << " (";
+      for (int j = 0; j < num_args; j++) {
+        if (j > 0) {
+          stream << ", ";
+        }
+        printer.PrintRawValue(args[j]);
+      }
+      if (entry.num_args > num_args) {
+        if (num_args > 0) {
+          stream << ", ";
+        }
+        printer.PrintVariableArguments(entry.num_args - num_args);
+      }
+      stream << ")";
+    }
+
+    if (crashdetect == 0) {
+      stream << " from <unloaded script>";
+    } else if (!crashdetect->amx_name_.empty()) {
+      stream << " from " << crashdetect->amx_name_;
+    }
+
+    // The CIP points past the instruction that made the call, like a return
+    // address.
+    cell cip = entry.cip;
+    if (crashdetect != 0 && !crashdetect->breaks_.empty() && cip != 0) {
+      cip = AMXStackFramePrinter::GetOriginalAddress(crashdetect->breaks_,
+                                                     cip - sizeof(cell))
+            + sizeof(cell);
+    }
+    stream << " (cip " << HexDword(cip) << ", ";
+    if (ticks_per_ms > 0) {
+      stream << std::fixed << std::setprecision(3)
+             << (now - entry.timestamp) / ticks_per_ms << " ms ago)";
+    } else {
+      stream << now - entry.timestamp << " ticks ago)";
+    }
+    stream << std::endl;
+  }
+}
+
 // static
 void CrashDetect::PrintNativeBacktrace(void *context) {
   std::stringstream stream;
@@ -319,56 +622,202 @@ void CrashDetect::PrintNativeBacktrace(std::ostream &stream, void *context) {
   }
 }
 
+void CrashDetect::AddLoadTime(LoadPhase phase, std::uint64_t time) {
+  load_times_[phase] += time;
+}
+
+// static
+void CrashDetect::AddPluginLoadTime(LoadPhase phase, std::uint64_t time) {
+  plugin_load_times_[phase] += time;
+}
+
+// static
+void CrashDetect::PrintLoadTimes() {
+  std::stringstream stream;
+  PrintLoadTimes(stream);
+  PrintLines(stream.str());
+}
+
+// static
+void CrashDetect::PrintLoadTimes(std::ostream &stream) {
+  stream << "Load times in ms (plugin:"
+         << " hooks " << Milliseconds(plugin_load_times_[kLoadHooks])
+         << ", config " << Milliseconds(plugin_load_times_[kLoadConfig])
+         << ", updater " << Milliseconds(plugin_load_times_[kLoadUpdater])
+         << "):\n";
+
+  const int kNameWidth = 20;
+  const int kWidth = 10;
+  stream << std::left << std::setw(kNameWidth) << "script" << std::right
+         << std::setw(kWidth) << "path"
+         << std::setw(kWidth) << "debug"
+         << std::setw(kWidth) << "analysis"
+         << std::setw(kWidth) << "natives"
+         << std::setw(kWidth) << "hooks"
+         << std::setw(kWidth) << "total" << std::endl;
+
+  // Slowest first.
+  std::vector<std::pair<std::uint64_t, CrashDetect*> > scripts;
+  for (ServiceMap::const_iterator it = service_map_.begin();
+       it != service_map_.end(); it++) {
+    CrashDetect *crashdetect = it->second;
+    scripts.push_back(std::make_pair(
+      GetTotalLoadTime(crashdetect->load_times_), crashdetect));
+  }
+  std::sort(scripts.rbegin(), scripts.rend());
+
+  for (std::size_t i = 0; i < scripts.size(); i++) {
+    const CrashDetect *crashdetect = scripts[i].second;
+    const std::uint64_t *times = crashdetect->load_times_;
+    std::string name = crashdetect->amx_name_;
+    if (name.empty()) {
+      name = "<unknown>";
+    }
+    stream << std::left << std::setw(kNameWidth) << name << std::right
+           << std::setw(kWidth) << Milliseconds(times[kLoadPath])
+           << std::setw(kWidth) << Milliseconds(times[kLoadDebugInfo])
+           << std::setw(kWidth) << Milliseconds(times[kLoadAnalysis])
+           << std::setw(kWidth) << Milliseconds(times[kLoadNatives])
+           << std::setw(kWidth) << Milliseconds(times[kLoadHooks])
+           << std::setw(kWidth) << Milliseconds(scripts[i].first)
+           << std::endl;
+  }
+}
+
 CrashDetect::CrashDetect(AMX *amx)
  : AMXService<CrashDetect>(amx),
    amx_(amx),
-   prev_callback_(0)
+   prev_callback_(0),
+   fingerprint_(0)
 {
-
+  std::fill(load_times_, load_times_ + kNumLoadPhases, 0);
 }
 
 int CrashDetect::Load() {
-  AMXPathFinder pathFinder;
-  pathFinder.AddSearchPath("gamemodes");
-  pathFinder.AddSearchPath("filterscripts");
+  std::uint64_t start_time = os::GetMicroseconds();
 
-  // Read a list of additional search paths from AMX_PATH.
-  const char *AMX_PATH = getenv("AMX_PATH");
-  if (AMX_PATH != 0) {
-    std::string var(AMX_PATH);
-    std::string path;
-    std::string::size_type begin = 0;
-    while (begin < var.length()) {
-      std::string::size_type end = var.find(fileutils::kNativePathListSepChar, begin);
-      if (end == std::string::npos) {
-        end = var.length();
-      }
-      path.assign(var.begin() + begin, var.begin() + end);
-      if (!path.empty()) {
-        pathFinder.AddSearchPath(path);
-      }
-      begin = end + 1;
+  amx_path_ = path_finder_.FindAmx(amx_);
+  amx_name_ = fileutils::GetFileName(amx_path_);
+  AddLoadTime(kLoadPath, Lap(start_time));
+
+  AMXOptimizer optimizer(amx_);
+  optimizer.SortCaseTables();
+
+  if (raw_backtrace_) {
+    fingerprint_ = GetAmxFingerprint(amx_);
+  } else if (AMXDebugInfo::IsPresent(amx_)) {
+    if (!amx_path_.empty()) {
+      LoadDebugInfo(amx_path_);
+    }
+  } else {
+    // The script may have been stripped of debug info and shipped with
+    // a separate .amx.dbg file.
+    std::string debug_info_path = path_finder_.FindDebugInfo(amx_);
+    if (!debug_info_path.empty()) {
+      LoadDebugInfo(debug_info_path);
     }
   }
 
-  amx_path_ = pathFinder.FindAmx(amx_);
-  amx_name_ = fileutils::GetFileName(amx_path_);
-
-  if (!amx_path_.empty() && AMXDebugInfo::IsPresent(amx_)) {
-    debug_info_.Load(amx_path_);
+  // BREAKs only matter to debug hooks. Removing them moves the code, so this
+  // is done only if the debug info can be moved along with it (raw
+  // backtraces must match the .amx file).
+  if (elide_breaks_ && !foreign_exec_ && debug_info_.IsLoaded()
+      && amx_.GetDebugHook() == 0) {
+    if (optimizer.RemoveBreaks(breaks_) > 0) {
+      debug_info_.RemoveCode(breaks_);
+    }
+  }
+  AddLoadTime(kLoadDebugInfo, Lap(start_time));
+
+  // The opcodes of scripts relocated for another interpreter are unknown
+  // to the disassembler.
+  if (!foreign_exec_) {
+    if (verify_) {
+      AMXVerifier verifier(amx_);
+      if (verifier.Verify()) {
+        CheckStackUsage(verifier);
+        if (elide_stack_checks_) {
+          optimizer.RemoveRedundantChecks(verifier);
+        }
+        if (elide_bounds_) {
+          optimizer.RemoveRedundantBoundsChecks(verifier);
+        }
+      } else {
+        Printf("%s failed verification: %s at address %08x",
+               amx_name_.c_str(), verifier.error().c_str(),
+               verifier.error_address());
+      }
+    }
+    if (direct_natives_) {
+      optimizer.UseDirectNatives();
+    }
+    if (superinstructions_) {
+      optimizer.FuseInstructions();
+    }
   }
 
+  // Public addresses are final now.
+  AMXScriptIndex::Create(amx_);
+  AddLoadTime(kLoadAnalysis, Lap(start_time));
+
   amx_.DisableSysreqD();
   prev_callback_ = amx_.GetCallback();
 
+  if (enabled_) {
+    Attach();
+  }
+  AddLoadTime(kLoadHooks, Lap(start_time));
+
   return AMX_ERR_NONE;
 }
 
+void CrashDetect::CheckStackUsage(const AMXVerifier &verifier) {
+  // amx_Exec() pushes the argument count and a return address.
+  cell available = amx_.GetStp() - amx_.GetHlw() - 2 * sizeof(cell);
+
+  for (int i = AMX_EXEC_MAIN; i < amx_.GetNumPublics(); i++) {
+    cell address = amx_.GetPublicAddress(i);
+    if (address < 0) {
+      continue;
+    }
+    cell usage = verifier.GetMaxUsage(address);
+    if (usage > available) {
+      const char *name = (i == AMX_EXEC_MAIN) ? "main" : amx_.GetPublicName(i);
+      Printf("%s: %s() may need up to %d bytes of stack/heap space, but "
+             "only %d are available (see #pragma dynamic)",
+             amx_name_.c_str(), name, usage, available);
+    }
+  }
+}
+
+void CrashDetect::LoadDebugInfo(const std::string &filename) {
+  if (!debug_info_preloader_.Take(filename, debug_info_)) {
+    debug_info_.Load(filename);
+  }
+}
+
 int CrashDetect::Unload() {
+  AMXScriptIndex::Destroy(amx_);
+  path_finder_.Forget(amx_);
   return AMX_ERR_NONE;
 }
 
+void CrashDetect::Attach() {
+  // Don't override callbacks set by other plugins after us.
+  if (amx_.GetCallback() == prev_callback_) {
+    amx_SetCallback(amx_, AmxCallback);
+  }
+}
+
+void CrashDetect::Detach() {
+  if (amx_.GetCallback() == AmxCallback) {
+    amx_SetCallback(amx_, prev_callback_);
+  }
+}
+
 int CrashDetect::DoAmxCallback(cell index, cell *result, cell *params) {
+  FlightRecorder::Record(FlightRecorder::kNative, amx_, index, amx_.GetCip(),
+                         params);
   NPCall call = NPCall::Native(amx_, index);
   np_calls_.push(&call);
   int error = prev_callback_(amx_, index, result, params);
@@ -377,6 +826,7 @@ int CrashDetect::DoAmxCallback(cell index, cell *result, cell *params) {
 }
 
 int CrashDetect::DoAmxExec(cell *retval, int index) {  
+  FlightRecorder::Record(FlightRecorder::kPublic, amx_, index, amx_.GetCip());
   NPCall call = NPCall::Public(amx_, index);
   np_calls_.push(&call);
 
@@ -432,7 +882,12 @@ void CrashDetect::HandleExecError(int index, cell *retval, const AMXError &error
   PrintAmxBacktrace(bt_stream);
 
   // public OnRuntimeError(code, &bool:suppress);
-  cell callback_index = amx_.GetPublicIndex("OnRuntimeError");
+  cell callback_index = -1;
+  if (const AMXScriptIndex *index = AMXScriptIndex::Find(amx_)) {
+    callback_index = index->GetCallbackIndex(AMXScriptIndex::kOnRuntimeError);
+  } else {
+    callback_index = amx_.GetPublicIndex("OnRuntimeError");
+  }
   cell suppress = 0;
 
   if (callback_index >= 0) {
@@ -28,17 +28,36 @@
 #include <map>
 #include <stack>
 #include <string>
+#include <vector>
 
 #include <amx/amx.h>
 
 #include "amxdebuginfo.h"
+#include "amxdebuginfopreloader.h"
+#include "amxpathfinder.h"
 #include "amxscript.h"
 #include "amxservice.h"
+#include "cstdint.h"
 
 class AMXError;
+class AMXVerifier;
+class ConfigReader;
 class NPCall;
 
 class CrashDetect : public AMXService<CrashDetect> {
+ public:
+  // What the time spent loading the plugin and each script goes to.
+  enum LoadPhase {
+    kLoadPath,       // looking for the .amx file
+    kLoadDebugInfo,  // looking for and reading debug info
+    kLoadAnalysis,   // verification and optimizations
+    kLoadNatives,    // native registration by all plugins
+    kLoadHooks,      // installing hooks and callbacks
+    kLoadConfig,     // reading server.cfg and scanning scripts (plugin only)
+    kLoadUpdater,    // starting the version check (plugin only)
+    kNumLoadPhases
+  };
+
  public:
   virtual ~CrashDetect() {}
  
@@ -52,6 +71,9 @@ class CrashDetect : public AMXService<CrashDetect> {
   int DoAmxCallback(cell index, cell *result, cell *params);
   int DoAmxExec(cell *retval, int index);
 
+  void Attach();
+  void Detach();
+
   void HandleException();
   void HandleInterrupt();
   void HandleExecError(int index, cell *retval, const AMXError &error);
@@ -59,28 +81,80 @@ class CrashDetect : public AMXService<CrashDetect> {
   static void OnException(void *context);
   static void OnInterrupt(void *context);
 
+ public:
+  static void Configure(const ConfigReader &config);
+
+  // Called once the scripts loaded at startup have been loaded.
+  static void FinishStartup();
+
+  // When disabled, scripts' native calls go directly to the server and
+  // public calls skip all bookkeeping, so runtime errors and crashes are
+  // reported without AMX backtraces.
+  static bool IsEnabled() { return enabled_; }
+  static void SetEnabled(bool enabled);
+
+  // Set when another plugin hooked amx_Exec() before us: scripts are then
+  // relocated for its interpreter and their code is left as it is.
+  static void SetForeignExec(bool foreign) { foreign_exec_ = foreign; }
+
+  // Applies to scripts loaded after the call.
+  static void SetSuperinstructions(bool enabled) {
+    superinstructions_ = enabled;
+  }
+
  public:
   static void PrintAmxBacktrace();
   static void PrintAmxBacktrace(std::ostream &stream);
 
+  static void PrintFlightRecorder();
+  static void PrintFlightRecorder(std::ostream &stream);
+
   static void PrintNativeBacktrace(void *context);
   static void PrintNativeBacktrace(std::ostream &stream, void *context);
 
+  // Load times are in microseconds.
+  void AddLoadTime(LoadPhase phase, std::uint64_t time);
+  static void AddPluginLoadTime(LoadPhase phase, std::uint64_t time);
+
+  // Prints how long it took to load the plugin and each of the scripts.
+  static void PrintLoadTimes();
+  static void PrintLoadTimes(std::ostream &stream);
+  static bool ShouldPrintLoadTimes() { return print_load_times_; }
+
  private:
   static void Printf(const char *format, ...);
   static void PrintLines(std::string string);
 
   static void PrintError(AMXScript amx, const AMXError &error);
 
+  void CheckStackUsage(const AMXVerifier &verifier);
+  void LoadDebugInfo(const std::string &filename);
+
  private:
   AMXScript amx_;
   AMXDebugInfo debug_info_;
   std::string amx_path_;
   std::string amx_name_;
   AMX_CALLBACK prev_callback_;
+  uint32_t fingerprint_;
+  std::vector<cell> breaks_; // removed BREAKs (crashdetect_elide_breaks)
+  std::uint64_t load_times_[kNumLoadPhases];
 
  private:
+  static bool enabled_;
   static bool block_exec_errors_;
+  static bool raw_backtrace_;
+  static bool superinstructions_;
+  static bool direct_natives_;
+  static bool verify_;
+  static bool elide_stack_checks_;
+  static bool elide_bounds_;
+  static bool elide_breaks_;
+  static bool print_load_times_;
+  static bool foreign_exec_;
+  static std::uint64_t plugin_load_times_[kNumLoadPhases];
+  static AMXPathFinder path_finder_;
+  static AMXDebugInfoPreloader debug_info_preloader_;
   static std::stack<NPCall*> np_calls_;
 };
 
@@ -0,0 +1,134 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#define _GNU_SOURCE
+
+#include <cerrno>
+#include <string>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "crashdump.h"
+#include "cstdint.h"
+
+static int dump_fd = -1;
+
+// static
+bool CrashDump::FileOpen(const std::string &filename) {
+  FileClose();
+  // Don't truncate: the previous dump survives until the next crash.
+  ::dump_fd = open(filename.c_str(), O_WRONLY | O_CREAT, 0644);
+  return ::dump_fd >= 0;
+}
+
+// static
+void CrashDump::FileClose() {
+  if (::dump_fd >= 0) {
+    close(::dump_fd);
+    ::dump_fd = -1;
+  }
+}
+
+// static
+bool CrashDump::IsOpen() {
+  return ::dump_fd >= 0;
+}
+
+// static
+std::size_t CrashDump::FileWrite(const void *data, std::size_t size) {
+  const char *ptr = reinterpret_cast<const char*>(data);
+  std::size_t written = 0;
+  while (written < size) {
+    // write() fails with EFAULT (or stops short) if the source memory is
+    // not readable, which is exactly what we want for raw memory dumps.
+    ssize_t result = write(::dump_fd, ptr + written, size - written);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      break;
+    }
+    written += result;
+  }
+  return written;
+}
+
+// static
+void CrashDump::FileWriteAt(std::uint32_t offset, const void *data,
+                            std::size_t size) {
+  pwrite(::dump_fd, data, size, offset);
+}
+
+// static
+void CrashDump::FileRewind() {
+  lseek(::dump_fd, 0, SEEK_SET);
+}
+
+// static
+void CrashDump::FileTruncate(std::uint32_t size) {
+  ftruncate(::dump_fd, size);
+  fsync(::dump_fd);
+}
+
+// static
+bool CrashDump::GetRegisters(void *context, std::uint32_t registers[10]) {
+  if (context == 0) {
+    return false;
+  }
+  const mcontext_t &mcontext = static_cast<ucontext_t*>(context)->uc_mcontext;
+  registers[0] = mcontext.gregs[REG_EIP];
+  registers[1] = mcontext.gregs[REG_ESP];
+  registers[2] = mcontext.gregs[REG_EBP];
+  registers[3] = mcontext.gregs[REG_EAX];
+  registers[4] = mcontext.gregs[REG_EBX];
+  registers[5] = mcontext.gregs[REG_ECX];
+  registers[6] = mcontext.gregs[REG_EDX];
+  registers[7] = mcontext.gregs[REG_ESI];
+  registers[8] = mcontext.gregs[REG_EDI];
+  registers[9] = mcontext.gregs[REG_EFL];
+  return true;
+}
+
+// static
+void CrashDump::WriteModules() {
+  int maps_fd = open("/proc/self/maps", O_RDONLY);
+  if (maps_fd < 0) {
+    return;
+  }
+  char buffer[1024];
+  ssize_t size;
+  while ((size = read(maps_fd, buffer, sizeof(buffer))) != 0) {
+    if (size < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    Append(buffer, size);
+  }
+  close(maps_fd);
+}
@@ -0,0 +1,131 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <string>
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <tlhelp32.h>
+
+#include "crashdump.h"
+#include "cstdint.h"
+
+static HANDLE dump_file = INVALID_HANDLE_VALUE;
+
+// static
+bool CrashDump::FileOpen(const std::string &filename) {
+  FileClose();
+  // OPEN_ALWAYS: the previous dump survives until the next crash.
+  ::dump_file = CreateFileA(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ,
+                            0, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+  return ::dump_file != INVALID_HANDLE_VALUE;
+}
+
+// static
+void CrashDump::FileClose() {
+  if (::dump_file != INVALID_HANDLE_VALUE) {
+    CloseHandle(::dump_file);
+    ::dump_file = INVALID_HANDLE_VALUE;
+  }
+}
+
+// static
+bool CrashDump::IsOpen() {
+  return ::dump_file != INVALID_HANDLE_VALUE;
+}
+
+// static
+std::size_t CrashDump::FileWrite(const void *data, std::size_t size) {
+  // WriteFile() fails with ERROR_NOACCESS if the source memory is not
+  // readable, which is exactly what we want for raw memory dumps.
+  DWORD written = 0;
+  if (!WriteFile(::dump_file, data, static_cast<DWORD>(size), &written, 0)) {
+    return 0;
+  }
+  return written;
+}
+
+// static
+void CrashDump::FileWriteAt(std::uint32_t offset, const void *data,
+                            std::size_t size) {
+  DWORD position = SetFilePointer(::dump_file, 0, 0, FILE_CURRENT);
+  SetFilePointer(::dump_file, offset, 0, FILE_BEGIN);
+  DWORD written;
+  WriteFile(::dump_file, data, static_cast<DWORD>(size), &written, 0);
+  SetFilePointer(::dump_file, position, 0, FILE_BEGIN);
+}
+
+// static
+void CrashDump::FileRewind() {
+  SetFilePointer(::dump_file, 0, 0, FILE_BEGIN);
+}
+
+// static
+void CrashDump::FileTruncate(std::uint32_t size) {
+  SetFilePointer(::dump_file, size, 0, FILE_BEGIN);
+  SetEndOfFile(::dump_file);
+  FlushFileBuffers(::dump_file);
+}
+
+// static
+bool CrashDump::GetRegisters(void *context, std::uint32_t registers[10]) {
+  if (context == 0) {
+    return false;
+  }
+  const CONTEXT *ctx = static_cast<CONTEXT*>(context);
+  registers[0] = ctx->Eip;
+  registers[1] = ctx->Esp;
+  registers[2] = ctx->Ebp;
+  registers[3] = ctx->Eax;
+  registers[4] = ctx->Ebx;
+  registers[5] = ctx->Ecx;
+  registers[6] = ctx->Edx;
+  registers[7] = ctx->Esi;
+  registers[8] = ctx->Edi;
+  registers[9] = ctx->EFlags;
+  return true;
+}
+
+// static
+void CrashDump::WriteModules() {
+  HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE, 0);
+  if (snapshot == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  MODULEENTRY32 module;
+  module.dwSize = sizeof(module);
+  if (Module32First(snapshot, &module)) {
+    do {
+      // Use the same format as /proc/self/maps so that the offline tool
+      // doesn't have to care about the platform.
+      char line[MAX_PATH + 64];
+      DWORD start = reinterpret_cast<DWORD>(module.modBaseAddr);
+      int length = wsprintfA(line, "%08x-%08x r-xp 00000000 00:00 0 %s\n",
+                             start, start + module.modBaseSize,
+                             module.szExePath);
+      Append(line, length);
+    } while (Module32Next(snapshot, &module));
+  }
+  CloseHandle(snapshot);
+}
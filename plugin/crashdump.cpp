@@ -0,0 +1,208 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstring>
+#include <deque>
+#include <string>
+
+#include "amxscript.h"
+#include "crashdump.h"
+#include "cstdint.h"
+#include "npcall.h"
+
+std::uint32_t CrashDump::file_position_ = 0;
+std::uint32_t CrashDump::record_offset_ = 0;
+std::uint32_t CrashDump::record_size_ = 0;
+
+// static
+bool CrashDump::Open(const std::string &filename) {
+  return FileOpen(filename);
+}
+
+// static
+void CrashDump::Close() {
+  FileClose();
+}
+
+// static
+void CrashDump::Write(void *context, const std::deque<NPCall*> &np_calls,
+                      const AMX_NATIVECALL *native_calls,
+                      const char *amx_name,
+                      const std::vector<cell> *breaks) {
+  if (!IsOpen()) {
+    return;
+  }
+
+  FileRewind();
+  file_position_ = 0;
+
+  static const char kMagic[4] = {'C', 'D', 'M', 'P'};
+  Append(kMagic, sizeof(kMagic));
+  std::uint32_t version = kVersion;
+  Append(&version, sizeof(version));
+
+  std::uint32_t registers[10];
+  if (GetRegisters(context, registers)) {
+    WriteRecord(kRegisters, registers, sizeof(registers));
+
+    // Copy as much of the stack as we can get starting from ESP. Reading
+    // past the end of the stack is fine: the write fails before we could
+    // touch an unmapped page.
+    std::uint32_t esp = registers[1];
+    WriteMemoryRecord(kNativeStack, esp, reinterpret_cast<void*>(esp),
+                      kMaxNativeStackSize);
+  }
+
+  BeginRecord(kModules);
+  WriteModules();
+  EndRecord();
+
+  if (!np_calls.empty()) {
+    AMXScript amx = np_calls.back()->amx();
+
+    AmxState state;
+    state.amx = reinterpret_cast<std::uint32_t>(amx.amx());
+    state.cip = amx.GetCip();
+    state.frm = amx.GetFrm();
+    state.stk = amx.GetStk();
+    state.hea = amx.GetHea();
+    state.hlw = amx.GetHlw();
+    state.stp = amx.GetStp();
+    state.pri = amx.GetPri();
+    state.alt = amx.GetAlt();
+
+    BeginRecord(kAmxState);
+    Append(&state, sizeof(state));
+    if (amx_name != 0) {
+      Append(amx_name, std::strlen(amx_name));
+    }
+    Append("", 1);
+    EndRecord();
+
+    BeginRecord(kAmxCalls);
+    for (std::deque<NPCall*>::const_reverse_iterator it = np_calls.rbegin();
+         it != np_calls.rend(); it++) {
+      const NPCall *np_call = *it;
+      WriteNativeCalls(native_calls, np_call->outer_native_calls());
+      AmxCall call;
+      call.type = np_call->IsPublic() ? 1 : 0;
+      call.amx = reinterpret_cast<std::uint32_t>(np_call->amx().amx());
+      call.index = np_call->index();
+      call.frm = np_call->frm();
+      call.cip = np_call->cip();
+      Append(&call, sizeof(call));
+    }
+    EndRecord();
+
+    if (breaks != 0 && !breaks->empty()) {
+      WriteRecord(kAmxBreaks, &(*breaks)[0], breaks->size() * sizeof(cell));
+    }
+
+    const unsigned char *data = amx.GetData();
+    if (amx.GetHea() > amx.GetHlw()) {
+      WriteMemoryRecord(kAmxHeap, amx.GetHlw(), data + amx.GetHlw(),
+                        amx.GetHea() - amx.GetHlw());
+    }
+    if (amx.GetStp() > amx.GetStk() && amx.GetStk() >= amx.GetHlw()) {
+      WriteMemoryRecord(kAmxStack, amx.GetStk(), data + amx.GetStk(),
+                        amx.GetStp() - amx.GetStk());
+    }
+  }
+
+  WriteRecord(kEnd, 0, 0);
+  FileTruncate(file_position_);
+}
+
+// static
+void CrashDump::WriteNativeCalls(const AMX_NATIVECALL *&native_calls,
+                                 const AMX_NATIVECALL *end) {
+  for (; native_calls != 0 && native_calls != end;
+       native_calls = native_calls->prev) {
+    AMXScript amx(native_calls->amx);
+    AmxCall call;
+    call.type = 0;
+    call.amx = reinterpret_cast<std::uint32_t>(native_calls->amx);
+    call.index = native_calls->index;
+    call.frm = amx.GetFrm();
+    call.cip = amx.GetCip();
+    Append(&call, sizeof(call));
+  }
+}
+
+// static
+std::size_t CrashDump::Append(const void *data, std::size_t size) {
+  std::size_t written = FileWrite(data, size);
+  file_position_ += written;
+  record_size_ += written;
+  return written;
+}
+
+// static
+void CrashDump::BeginRecord(RecordType type) {
+  std::uint32_t header[2] = {type, 0};
+  record_offset_ = file_position_;
+  Append(header, sizeof(header));
+  record_size_ = 0;
+}
+
+// static
+void CrashDump::EndRecord() {
+  FileWriteAt(record_offset_ + sizeof(std::uint32_t),
+              &record_size_, sizeof(record_size_));
+}
+
+// static
+void CrashDump::WriteRecord(RecordType type, const void *data,
+                            std::size_t size) {
+  BeginRecord(type);
+  if (size > 0) {
+    Append(data, size);
+  }
+  EndRecord();
+}
+
+// static
+void CrashDump::WriteMemoryRecord(RecordType type, std::uint32_t address,
+                                  const void *data, std::size_t size) {
+  BeginRecord(type);
+  Append(&address, sizeof(address));
+
+  // Write page by page and stop at the first inaccessible one.
+  const unsigned char *ptr = reinterpret_cast<const unsigned char*>(data);
+  const unsigned char *end = ptr + size;
+  while (ptr < end) {
+    std::size_t chunk_size = kMemoryChunkSize
+      - reinterpret_cast<std::uint32_t>(ptr) % kMemoryChunkSize;
+    if (chunk_size > static_cast<std::size_t>(end - ptr)) {
+      chunk_size = end - ptr;
+    }
+    std::size_t written = Append(ptr, chunk_size);
+    if (written != chunk_size) {
+      break;
+    }
+    ptr += chunk_size;
+  }
+
+  EndRecord();
+}
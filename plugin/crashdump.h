@@ -0,0 +1,140 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CRASHDUMP_H
+#define CRASHDUMP_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <amx/amx.h>
+
+#include "cstdint.h"
+
+class NPCall;
+
+// CrashDump writes a compact binary snapshot of the server's state at the
+// moment of a crash: CPU registers, raw native stack, loaded modules, and
+// the registers and stack/heap of the AMX that was running. The output file
+// is opened in advance and the snapshot is written with raw system calls
+// only (no stdio, no memory allocation), so Write() is safe to call from a
+// signal handler. tools/crashinfo.py --dump turns the file into backtraces.
+//
+// The file consists of a header followed by a sequence of records:
+//
+//   Header: char magic[4] = "CDMP", uint32 version
+//   Record: uint32 type, uint32 size, uint8 data[size]
+//
+// All integers are little-endian. The last record is always of type kEnd.
+class CrashDump {
+ public:
+  static const std::uint32_t kVersion = 1;
+
+  enum RecordType {
+    kEnd         = 0,
+    kRegisters   = 1, // eip, esp, ebp, eax, ebx, ecx, edx, esi, edi, eflags
+    kNativeStack = 2, // uint32 address, raw bytes starting at that address
+    kModules     = 3, // text, one "start-end perms offset dev inode path" per line
+    kAmxState    = 4, // AmxState followed by the script's file name
+    kAmxCalls    = 5, // array of AmxCall, innermost call first
+    kAmxHeap     = 6, // uint32 address (HLW), raw bytes of [HLW, HEA)
+    kAmxStack    = 7, // uint32 address (STK), raw bytes of [STK, STP)
+    kAmxBreaks   = 8  // array of uint32, original addresses of the BREAKs
+                      // removed from the code (AMX addresses in the dump
+                      // are in the compacted code)
+  };
+
+  struct AmxState {
+    std::uint32_t amx;
+    std::uint32_t cip;
+    std::uint32_t frm;
+    std::uint32_t stk;
+    std::uint32_t hea;
+    std::uint32_t hlw;
+    std::uint32_t stp;
+    std::uint32_t pri;
+    std::uint32_t alt;
+  };
+
+  struct AmxCall {
+    std::uint32_t type; // 0 = native, 1 = public
+    std::uint32_t amx;
+    std::uint32_t index;
+    std::uint32_t frm;
+    std::uint32_t cip;
+  };
+
+  // Opens (or creates) the dump file. The previous dump is kept until it's
+  // overwritten by a new one.
+  static bool Open(const std::string &filename);
+  static void Close();
+  static bool IsOpen();
+
+  // Writes a snapshot. context is a ucontext_t* on Linux and a CONTEXT* on
+  // Windows (i.e. what os::ExceptionHandler receives), np_calls is the
+  // stack of public/native calls maintained by CrashDetect (top at back)
+  // and native_calls are the direct native calls made by the interpreter
+  // (see amx_GetNativeCalls()), which are merged into it. breaks are the
+  // BREAKs removed from the script's code, if any.
+  static void Write(void *context, const std::deque<NPCall*> &np_calls,
+                    const AMX_NATIVECALL *native_calls,
+                    const char *amx_name,
+                    const std::vector<cell> *breaks);
+
+ private:
+  static std::size_t Append(const void *data, std::size_t size);
+
+  static void BeginRecord(RecordType type);
+  static void EndRecord();
+
+  static void WriteRecord(RecordType type, const void *data, std::size_t size);
+  static void WriteMemoryRecord(RecordType type, std::uint32_t address,
+                                const void *data, std::size_t size);
+  static void WriteNativeCalls(const AMX_NATIVECALL *&native_calls,
+                               const AMX_NATIVECALL *end);
+
+  // Platform-specific parts (crashdump-unix.cpp, crashdump-win32.cpp).
+  static bool FileOpen(const std::string &filename);
+  static void FileClose();
+  static std::size_t FileWrite(const void *data, std::size_t size);
+  static void FileWriteAt(std::uint32_t offset, const void *data,
+                          std::size_t size);
+  static void FileRewind();
+  static void FileTruncate(std::uint32_t size);
+
+  static bool GetRegisters(void *context, std::uint32_t registers[10]);
+  static void WriteModules();
+
+ private:
+  static const std::size_t kMaxNativeStackSize = 64 * 1024;
+  static const std::size_t kMemoryChunkSize = 4096;
+
+  static std::uint32_t file_position_;
+  static std::uint32_t record_offset_;
+  static std::uint32_t record_size_;
+};
+
+#endif // !CRASHDUMP_H
@@ -0,0 +1,101 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstddef>
+#include <ctime>
+
+#include "flightrecorder.h"
+
+FlightRecorder::Entry *FlightRecorder::entries_ = 0;
+cell *FlightRecorder::args_ = 0;
+int FlightRecorder::max_args_ = 0;
+std::uint32_t FlightRecorder::mask_ = 0;
+std::uint32_t FlightRecorder::position_ = 0;
+std::uint64_t FlightRecorder::start_timestamp_ = 0;
+std::time_t FlightRecorder::start_time_ = 0;
+
+// static
+void FlightRecorder::Init(std::size_t size, int max_args) {
+  delete[] entries_;
+  delete[] args_;
+  entries_ = 0;
+  args_ = 0;
+  max_args_ = 0;
+  mask_ = 0;
+  position_ = 0;
+
+  if (size == 0) {
+    return;
+  }
+
+  std::size_t capacity = 1;
+  while (capacity < size) {
+    capacity <<= 1;
+  }
+
+  entries_ = new Entry[capacity];
+  mask_ = static_cast<std::uint32_t>(capacity - 1);
+
+  if (max_args > 0) {
+    args_ = new cell[capacity * max_args];
+    max_args_ = max_args;
+  }
+
+  start_timestamp_ = compiler::ReadTimestampCounter();
+  start_time_ = std::time(0);
+}
+
+// static
+std::size_t FlightRecorder::GetNumEntries() {
+  if (entries_ == 0) {
+    return 0;
+  }
+  if (position_ > mask_) {
+    return mask_ + 1;
+  }
+  return position_;
+}
+
+// static
+const FlightRecorder::Entry &FlightRecorder::GetEntry(std::size_t index) {
+  return entries_[(position_ - 1 - index) & mask_];
+}
+
+// static
+const cell *FlightRecorder::GetArgs(std::size_t index) {
+  if (args_ == 0) {
+    return 0;
+  }
+  return args_ + ((position_ - 1 - index) & mask_) * max_args_;
+}
+
+// static
+double FlightRecorder::GetTicksPerSecond() {
+  std::time_t seconds = std::time(0) - start_time_;
+  if (seconds < 1) {
+    return 0;
+  }
+  std::uint64_t ticks = compiler::ReadTimestampCounter() - start_timestamp_;
+  return static_cast<double>(ticks) / seconds;
+}
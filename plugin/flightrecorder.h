@@ -0,0 +1,121 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef FLIGHTRECORDER_H
+#define FLIGHTRECORDER_H
+
+#include <cstddef>
+#include <ctime>
+
+#include <amx/amx.h>
+
+#include "compiler.h"
+#include "cstdint.h"
+
+// FlightRecorder keeps a fixed-size ring buffer of the most recent public
+// and native calls so that crash reports can show how the server got to
+// the point of the crash. Recording is just a few stores: names are
+// resolved from the indices only when the buffer is printed.
+//
+// There is only one writer (the thread that runs scripts) and the buffer is
+// read from the crash handler on the same thread, so no locking is needed.
+//
+// Optionally the first few arguments of each native call are copied into a
+// separate array alongside the entries. Both are allocated once by Init().
+class FlightRecorder {
+ public:
+  enum CallType {
+    kNative,
+    kPublic
+  };
+
+  struct Entry {
+    std::uint64_t timestamp;
+    AMX *amx;
+    cell index;
+    cell cip;
+    CallType type;
+    int num_args; // number of arguments actually passed (natives only)
+  };
+
+  // Allocates a buffer for at least size entries (rounded up to a power of
+  // two) with room for max_args arguments per entry. Passing 0 as size
+  // disables recording.
+  static void Init(std::size_t size, int max_args = 0);
+  static bool IsEnabled() { return entries_ != 0; }
+
+  static int max_args() { return max_args_; }
+
+  // params is the native's parameter array (params[0] is the size of the
+  // arguments in bytes) or 0.
+  static void Record(CallType type, AMX *amx, cell index, cell cip,
+                     const cell *params = 0) {
+    if (entries_ != 0) {
+      std::uint32_t slot = position_++ & mask_;
+      Entry &entry = entries_[slot];
+      entry.timestamp = compiler::ReadTimestampCounter();
+      entry.amx = amx;
+      entry.index = index;
+      entry.cip = cip;
+      entry.type = type;
+      entry.num_args = 0;
+      if (params != 0) {
+        entry.num_args = static_cast<int>(params[0] / sizeof(cell));
+        if (max_args_ > 0) {
+          cell *args = args_ + slot * max_args_;
+          int num_args = entry.num_args < max_args_ ? entry.num_args
+                                                    : max_args_;
+          for (int i = 0; i < num_args; i++) {
+            args[i] = params[i + 1];
+          }
+        }
+      }
+    }
+  }
+
+  // Returns the number of recorded entries, at most the buffer size.
+  static std::size_t GetNumEntries();
+
+  // Returns the index-th most recent entry (0 is the most recent one).
+  static const Entry &GetEntry(std::size_t index);
+
+  // Returns the arguments captured for the index-th most recent entry, up to
+  // min(num_args, max_args()) of them.
+  static const cell *GetArgs(std::size_t index);
+
+  // Estimates the timestamp counter frequency from the time elapsed since
+  // Init(). Returns 0 if too little time has passed to tell.
+  static double GetTicksPerSecond();
+
+ private:
+  static Entry *entries_;
+  static cell *args_;
+  static int max_args_;
+  static std::uint32_t mask_;
+  static std::uint32_t position_;
+  static std::uint64_t start_timestamp_;
+  static std::time_t start_time_;
+};
+
+#endif // !FLIGHTRECORDER_H
@@ -0,0 +1,89 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstring>
+
+#include "nametable.h"
+
+NameTable::NameTable()
+ : size_(0)
+{
+}
+
+bool NameTable::Insert(const char *name, int value) {
+  if ((size_ + 1) * 2 > entries_.size()) {
+    Grow();
+  }
+  std::size_t mask = entries_.size() - 1;
+  std::size_t i = Hash(name) & mask;
+  for (; entries_[i].name != 0; i = (i + 1) & mask) {
+    if (std::strcmp(entries_[i].name, name) == 0) {
+      return false;
+    }
+  }
+  entries_[i].name = name;
+  entries_[i].value = value;
+  size_++;
+  return true;
+}
+
+int NameTable::Find(const char *name) const {
+  if (entries_.empty()) {
+    return -1;
+  }
+  std::size_t mask = entries_.size() - 1;
+  for (std::size_t i = Hash(name) & mask; entries_[i].name != 0;
+       i = (i + 1) & mask) {
+    if (std::strcmp(entries_[i].name, name) == 0) {
+      return entries_[i].value;
+    }
+  }
+  return -1;
+}
+
+void NameTable::Grow() {
+  std::vector<Entry> old_entries;
+  old_entries.swap(entries_);
+
+  Entry empty = {0, -1};
+  entries_.resize(old_entries.empty() ? 16 : old_entries.size() * 2, empty);
+  size_ = 0;
+
+  for (std::size_t i = 0; i < old_entries.size(); i++) {
+    if (old_entries[i].name != 0) {
+      Insert(old_entries[i].name, old_entries[i].value);
+    }
+  }
+}
+
+// static
+std::size_t NameTable::Hash(const char *name) {
+  // FNV-1a
+  std::size_t hash = 2166136261u;
+  for (const char *c = name; *c != '\0'; c++) {
+    hash ^= static_cast<unsigned char>(*c);
+    hash *= 16777619u;
+  }
+  return hash;
+}
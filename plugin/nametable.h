@@ -0,0 +1,62 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef NAMETABLE_H
+#define NAMETABLE_H
+
+#include <cstddef>
+#include <vector>
+
+// A hash table that maps names (C strings) to non-negative integers. It
+// doesn't copy the names, they must outlive the table.
+class NameTable {
+ public:
+  NameTable();
+
+  // Adds a name. If the name is already there the old value is kept and
+  // false is returned.
+  bool Insert(const char *name, int value);
+
+  // Returns the value for the name or -1 if there is none.
+  int Find(const char *name) const;
+
+  std::size_t size() const { return size_; }
+
+  // Returns the hash of the name's characters.
+  static std::size_t Hash(const char *name);
+
+ private:
+  struct Entry {
+    const char *name;
+    int value;
+  };
+
+  void Grow();
+
+ private:
+  std::vector<Entry> entries_;
+  std::size_t size_;
+};
+
+#endif // !NAMETABLE_H
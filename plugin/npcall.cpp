@@ -29,7 +29,8 @@ NPCall::NPCall(Type type, AMXScript amx, cell index)
    amx_(amx),
    frm_(amx.GetFrm()),
    cip_(amx.GetCip()),
-   index_(index)
+   index_(index),
+   outer_native_calls_(amx_GetNativeCalls())
 {
 }
 
@@ -38,7 +39,8 @@ NPCall::NPCall(Type type, AMXScript amx, cell index, cell frm, cell cip)
    amx_(amx),
    frm_(frm),
    cip_(cip),
-   index_(index)
+   index_(index),
+   outer_native_calls_(amx_GetNativeCalls())
 {
 }
 
@@ -48,6 +48,11 @@ class NPCall {
   cell frm() const { return frm_; }
   cell cip() const { return cip_; }
 
+  // Direct native calls (SYSREQ.N) that were active when this call was made.
+  const AMX_NATIVECALL *outer_native_calls() const {
+    return outer_native_calls_;
+  }
+
   bool IsPublic() const { return type_ == PUBLIC; }
   bool IsNative() const { return type_ == NATIVE; }
 
@@ -57,6 +62,7 @@ class NPCall {
   cell frm_;
   cell cip_;
   cell index_;
+  const AMX_NATIVECALL *outer_native_calls_;
 };
 
 #endif // !NPCALL_H
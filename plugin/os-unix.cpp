@@ -30,6 +30,7 @@
 
 #include <dlfcn.h>
 #include <signal.h>
+#include <sys/time.h>
 
 #include "os.h"
 
@@ -105,3 +106,9 @@ void os::SetInterruptHandler(InterruptHandler handler) {
 
   sigaction(SIGINT, &action, &::prev_sigint_action);
 }
+
+std::uint64_t os::GetMicroseconds() {
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return static_cast<std::uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
@@ -87,3 +87,13 @@ void os::SetInterruptHandler(InterruptHandler handler) {
   ::ctrl_handler_thread_id = GetCurrentThreadId();
   SetConsoleCtrlHandler(ConsoleCtrlHandler, TRUE);
 }
+
+std::uint64_t os::GetMicroseconds() {
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  std::uint64_t seconds = counter.QuadPart / frequency.QuadPart;
+  std::uint64_t remainder = counter.QuadPart % frequency.QuadPart;
+  return seconds * 1000000 + remainder * 1000000 / frequency.QuadPart;
+}
@@ -29,6 +29,8 @@
 #include <cstdio>
 #include <string>
 
+#include "cstdint.h"
+
 namespace os {
 
 // GetModulePathFromAddr finds which module (executable/DLL) a given 
@@ -48,6 +50,10 @@ typedef void (*InterruptHandler)(void *context);
 // and SIGINT signal handler on Linux.
 void SetInterruptHandler(InterruptHandler handler);
 
+// GetMicroseconds returns the time in microseconds elapsed since some
+// unspecified point in the past. Use it to measure how long things take.
+std::uint64_t GetMicroseconds();
+
 } // namespace os
 
 #endif // !OS_H
@@ -26,8 +26,12 @@
 #include <string>
 
 #include "amxerror.h"
+#include "amxnativelist.h"
+#include "amxstring.h"
 #include "compiler.h"
+#include "configreader.h"
 #include "crashdetect.h"
+#include "crashdump.h"
 #include "fileutils.h"
 #include "hook.h"
 #include "logprintf.h"
@@ -38,17 +42,54 @@
 #include "updater.h"
 #include "version.h"
 
-static int AMXAPI AmxCallback(AMX *amx, cell index, cell *result, cell *params) {
-  return CrashDetect::Get(amx)->DoAmxCallback(index, result, params);
-}
-
 static int AMXAPI AmxExec(AMX *amx, cell *retval, int index) {
-  if (amx->flags & AMX_FLAG_BROWSE) {
+  if ((amx->flags & AMX_FLAG_BROWSE) || !CrashDetect::IsEnabled()) {
     return amx_Exec(amx, retval, index);
   }
   return CrashDetect::Get(amx)->DoAmxExec(retval, index);
 }
 
+static int AMXAPI AmxStrLen(const cell *cstr, int *length) {
+  return amxstring::StrLen(cstr, length);
+}
+
+static int AMXAPI AmxGetString(char *dest, const cell *source, int use_wchar,
+                               size_t size) {
+  return amxstring::GetString(dest, source, use_wchar, size);
+}
+
+static int AMXAPI AmxSetString(cell *dest, const char *source, int pack,
+                               int use_wchar, size_t size) {
+  return amxstring::SetString(dest, source, pack, use_wchar, size);
+}
+
+// Set if amx_Register() calls go through AmxRegister(). The time they take
+// is then counted for all plugins, not only for us.
+static bool register_hooked = false;
+
+static int AMXAPI AmxRegister(AMX *amx, const AMX_NATIVE_INFO *nativelist,
+                              int number) {
+  std::uint64_t start_time = os::GetMicroseconds();
+  int error = AMXNativeList::Register(amx, nativelist, number);
+  CrashDetect *crashdetect = CrashDetect::Find(amx);
+  if (crashdetect != 0) {
+    crashdetect->AddLoadTime(CrashDetect::kLoadNatives,
+                             os::GetMicroseconds() - start_time);
+  }
+  return error;
+}
+
+// Redirects an AMX API function exported by the server to ours, unless
+// another plugin has already done so.
+static bool HookAmxExport(void **exports, int index, void *function) {
+  void *address = exports[index];
+  if (Hook::GetTargetAddress(reinterpret_cast<unsigned char*>(address)) == 0) {
+    new Hook(address, function);
+    return true;
+  }
+  return false;
+}
+
 static void AMXAPI AmxExecError(AMX *amx, cell index, cell *retval, int error) {
   CrashDetect::Get(amx)->HandleExecError(index, retval, error);
 }
@@ -99,11 +140,48 @@ cell AMX_NATIVE_CALL PrintNativeBacktrace(AMX *amx, cell *params) {
   return 1;
 }
 
+// native SetCrashDetectEnabled(bool:enabled);
+cell AMX_NATIVE_CALL SetCrashDetectEnabled(AMX *amx, cell *params) {
+  CrashDetect::SetEnabled(params[1] != 0);
+  return 1;
+}
+
+// native bool:IsCrashDetectEnabled();
+cell AMX_NATIVE_CALL IsCrashDetectEnabled(AMX *amx, cell *params) {
+  return CrashDetect::IsEnabled();
+}
+
+// native GetCrashDetectLoadTimes(string[], size = sizeof(string));
+cell AMX_NATIVE_CALL GetCrashDetectLoadTimes(AMX *amx, cell *params) {
+  cell string = params[1];
+  cell size = params[2];
+
+  cell *string_ptr;
+  if (amx_GetAddr(amx, string, &string_ptr) == AMX_ERR_NONE) {
+    std::stringstream stream;
+    CrashDetect::PrintLoadTimes(stream);
+    return amx_SetString(string_ptr, stream.str().c_str(),
+                         0, 0, size) == AMX_ERR_NONE;
+  }
+
+  return 0;
+}
+
+// native PrintCrashDetectLoadTimes();
+cell AMX_NATIVE_CALL PrintCrashDetectLoadTimes(AMX *amx, cell *params) {
+  CrashDetect::PrintLoadTimes();
+  return 1;
+}
+
 const AMX_NATIVE_INFO list[] = {
-  {"GetAmxBacktrace",      natives::GetAmxBacktrace},
-  {"PrintAmxBacktrace",    natives::PrintAmxBacktrace},
-  {"GetNativeBacktrace",   natives::GetNativeBacktrace},
-  {"PrintNativeBacktrace", natives::PrintNativeBacktrace}
+  {"GetAmxBacktrace",           natives::GetAmxBacktrace},
+  {"PrintAmxBacktrace",         natives::PrintAmxBacktrace},
+  {"GetNativeBacktrace",        natives::GetNativeBacktrace},
+  {"PrintNativeBacktrace",      natives::PrintNativeBacktrace},
+  {"SetCrashDetectEnabled",     natives::SetCrashDetectEnabled},
+  {"IsCrashDetectEnabled",      natives::IsCrashDetectEnabled},
+  {"GetCrashDetectLoadTimes",   natives::GetCrashDetectLoadTimes},
+  {"PrintCrashDetectLoadTimes", natives::PrintCrashDetectLoadTimes}
 };
 
 } // namespace natives
@@ -116,12 +194,15 @@ PLUGIN_EXPORT bool PLUGIN_CALL Load(void **ppData) {
   void **exports = reinterpret_cast<void**>(ppData[PLUGIN_DATA_AMX_EXPORTS]);
   ::logprintf = (logprintf_t)ppData[PLUGIN_DATA_LOGPRINTF];
 
+  std::uint64_t start_time = os::GetMicroseconds();
+
   void *amx_Exec_ptr = exports[PLUGIN_AMX_EXPORT_Exec];
   void *amx_Exec_sub = Hook::GetTargetAddress(reinterpret_cast<unsigned char*>(amx_Exec_ptr));
 
   if (amx_Exec_sub == 0) {
     new Hook(amx_Exec_ptr, (void*)AmxExec);
   } else {
+    CrashDetect::SetForeignExec(true);
     std::string module = fileutils::GetFileName(os::GetModulePathFromAddr(amx_Exec_sub));
     if (!module.empty()) {
       logprintf("  AMX errors won't be tracked because '%s' "
@@ -129,21 +210,63 @@ PLUGIN_EXPORT bool PLUGIN_CALL Load(void **ppData) {
     }
   }
 
+  std::uint64_t hooks_time = os::GetMicroseconds() - start_time;
+  start_time = os::GetMicroseconds();
+
+  ConfigReader server_cfg("server.cfg");
+  CrashDetect::Configure(server_cfg);
+
+  std::string dump_file;
+  server_cfg.GetOption("crashdetect_dump", dump_file);
+  if (!dump_file.empty() && !CrashDump::Open(dump_file)) {
+    logprintf("  Could not open crash dump file '%s'.", dump_file.c_str());
+  }
+
+  CrashDetect::AddPluginLoadTime(CrashDetect::kLoadConfig,
+                                 os::GetMicroseconds() - start_time);
+  start_time = os::GetMicroseconds();
+
+  if (server_cfg.GetOptionDefault("crashdetect_fast_strings", false)) {
+    HookAmxExport(exports, PLUGIN_AMX_EXPORT_StrLen, (void*)AmxStrLen);
+    HookAmxExport(exports, PLUGIN_AMX_EXPORT_GetString, (void*)AmxGetString);
+    HookAmxExport(exports, PLUGIN_AMX_EXPORT_SetString, (void*)AmxSetString);
+  }
+  if (server_cfg.GetOptionDefault("crashdetect_fast_register", false)) {
+    register_hooked = HookAmxExport(exports, PLUGIN_AMX_EXPORT_Register,
+                                    (void*)AmxRegister);
+  }
+
   os::SetExceptionHandler(CrashDetect::OnException);
   os::SetInterruptHandler(CrashDetect::OnInterrupt);
 
+  CrashDetect::AddPluginLoadTime(CrashDetect::kLoadHooks,
+                                 hooks_time + os::GetMicroseconds() - start_time);
+  start_time = os::GetMicroseconds();
+
   Updater::InitiateVersionFetch();
 
+  CrashDetect::AddPluginLoadTime(CrashDetect::kLoadUpdater,
+                                 os::GetMicroseconds() - start_time);
+
   logprintf("  CrashDetect v"PROJECT_VERSION_STRING" is OK.");
   return true;
 }
 
 PLUGIN_EXPORT int PLUGIN_CALL AmxLoad(AMX *amx) {
-  int error = CrashDetect::Create(amx)->Load();
+  CrashDetect *crashdetect = CrashDetect::Create(amx);
+  int error = crashdetect->Load();
   if (error == AMX_ERR_NONE) {
-    amx_SetCallback(amx, AmxCallback);
+    std::uint64_t start_time = os::GetMicroseconds();
     amx_SetExecErrorHandler(amx, AmxExecError);
-    return amx_Register(amx, natives::list, -1);
+    crashdetect->AddLoadTime(CrashDetect::kLoadHooks,
+                             os::GetMicroseconds() - start_time);
+
+    start_time = os::GetMicroseconds();
+    error = amx_Register(amx, natives::list, -1);
+    if (!register_hooked) {
+      crashdetect->AddLoadTime(CrashDetect::kLoadNatives,
+                               os::GetMicroseconds() - start_time);
+    }
   }
   return error;
 }
@@ -155,6 +278,16 @@ PLUGIN_EXPORT int PLUGIN_CALL AmxUnload(AMX *amx) {
 }
 
 PLUGIN_EXPORT void PLUGIN_CALL ProcessTick() {
+  // The first tick comes after all scripts have been loaded.
+  static bool first_tick = true;
+  if (first_tick) {
+    CrashDetect::FinishStartup();
+    if (CrashDetect::ShouldPrintLoadTimes()) {
+      CrashDetect::PrintLoadTimes();
+    }
+    first_tick = false;
+  }
+
   if (Updater::version_fetched()) {
     Version latest_version = Updater::latest_version();
     Version current_version(PROJECT_VERSION_STRING);
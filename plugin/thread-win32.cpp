@@ -62,12 +62,13 @@ class ThreadRunInfo {
   void *args_;
 };
 
-void __cdecl RunThread(void *args) {
+unsigned __stdcall RunThread(void *args) {
   ThreadRunInfo *run_info = (ThreadRunInfo *)args;
   Thread *thread = run_info->thread();
   thread->Start(run_info->args());
   thread->Finish();
   delete run_info;
+  return 0;
 }
 
 Thread::Thread()
@@ -83,13 +84,16 @@ Thread::Thread(ThreadRoutine func)
 }
 
 Thread::~Thread() {
+  if (info_->handle() != 0) {
+    CloseHandle((HANDLE)info_->handle());
+  }
   delete info_;
 }
 
 void Thread::Run(void *args) {
   ThreadRunInfo *run_info = new ThreadRunInfo(this, args);
   info_->set_finished(false);
-  info_->set_handle(_beginthread(&RunThread, 0, (void *)run_info));
+  info_->set_handle(_beginthreadex(0, 0, &RunThread, (void *)run_info, 0, 0));
 }
 
 void Thread::Start(void *args) {
@@ -97,8 +101,12 @@ void Thread::Start(void *args) {
 }
 
 void Thread::Join() {
-  while (!info_->is_finished()) {
-    Sleep(1);
+  // Unlike _beginthread(), _beginthreadex() doesn't close the handle when the
+  // thread exits, so we can wait on it instead of polling is_finished().
+  if (info_->handle() != 0) {
+    WaitForSingleObject((HANDLE)info_->handle(), INFINITE);
+    CloseHandle((HANDLE)info_->handle());
+    info_->set_handle(0);
   }
 }
 
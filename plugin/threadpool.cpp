@@ -0,0 +1,75 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+
+#include "threadpool.h"
+
+ThreadPool::Worker::Worker(TaskRoutine routine, void *args,
+                           std::size_t first, std::size_t step,
+                           std::size_t count)
+ : routine_(routine),
+   args_(args),
+   first_(first),
+   step_(step),
+   count_(count)
+{
+}
+
+void ThreadPool::Worker::Start(void *) {
+  for (std::size_t index = first_; index < count_; index += step_) {
+    routine_(args_, index);
+  }
+}
+
+const std::size_t ThreadPool::kDefaultMaxThreads;
+
+ThreadPool::ThreadPool(std::size_t max_threads)
+ : max_threads_(std::max<std::size_t>(max_threads, 1))
+{
+}
+
+ThreadPool::~ThreadPool() {
+  Wait();
+}
+
+void ThreadPool::Run(TaskRoutine routine, void *args, std::size_t count) {
+  Wait();
+
+  std::size_t num_threads = std::min(count, max_threads_);
+  for (std::size_t i = 0; i < num_threads; i++) {
+    Worker *worker = new Worker(routine, args, i, num_threads, count);
+    workers_.push_back(worker);
+    worker->Run();
+  }
+}
+
+void ThreadPool::Wait() {
+  for (std::vector<Worker*>::iterator iterator = workers_.begin();
+       iterator != workers_.end(); ++iterator) {
+    (*iterator)->Join();
+    delete *iterator;
+  }
+  workers_.clear();
+}
@@ -0,0 +1,81 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <cstddef>
+#include <vector>
+
+#include "thread.h"
+
+// ThreadPool runs a batch of independent tasks on a few threads. The tasks
+// are numbered from 0 to count - 1 and split between the threads up front:
+// thread k runs tasks k, k + N, k + 2N and so on, where N is the number of
+// threads. There is no locking, so each task should write its results to a
+// place of its own; they may be read after Wait() returns.
+class ThreadPool {
+ public:
+  typedef void (*TaskRoutine)(void *args, std::size_t index);
+
+  static const std::size_t kDefaultMaxThreads = 4;
+
+  explicit ThreadPool(std::size_t max_threads = kDefaultMaxThreads);
+
+  // Waits for the running tasks.
+  ~ThreadPool();
+
+  // Starts running routine(args, index) for each index in [0, count). Waits
+  // for the previous batch first.
+  void Run(TaskRoutine routine, void *args, std::size_t count);
+
+  // Waits for all tasks to complete.
+  void Wait();
+
+ private:
+  class Worker : public Thread {
+   public:
+    Worker(TaskRoutine routine, void *args, std::size_t first,
+           std::size_t step, std::size_t count);
+
+    virtual void Start(void *args);
+
+   private:
+    TaskRoutine routine_;
+    void *args_;
+    std::size_t first_;
+    std::size_t step_;
+    std::size_t count_;
+  };
+
+ private:
+  ThreadPool(const ThreadPool &);
+  void operator=(const ThreadPool &);
+
+ private:
+  std::size_t max_threads_;
+  std::vector<Worker*> workers_;
+};
+
+#endif // !THREADPOOL_H
@@ -0,0 +1,191 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// amxdbgbench - compares the line table layout of dbg_LoadInfo() (an array
+// of AMX_DBG_LINE searched linearly) with the compact one that CrashDetect
+// builds (AMXLineTable): memory use and the time it takes to find the line
+// for a random code address.
+//
+// Usage: amxdbgbench [<file.amx>...]
+//
+// Without arguments a line table of the largest size the debug info format
+// allows is generated.
+
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <amx/amx.h>
+#include <amx/amxdbg.h>
+
+#include "plugin/amxlinetable.h"
+
+#include "benchmark.h"
+
+namespace {
+
+const int kNumLookups = 4096;
+const std::uint64_t kMinTime = 500000; // microseconds
+
+volatile int32_t sink;
+
+// What AMXDebugInfo::GetLine() used to do.
+AMX_DBG_LINE FindLinear(const std::vector<AMX_DBG_LINE> &lines,
+                        cell address) {
+  std::size_t last = 0;
+  for (std::size_t i = 0;
+       i < lines.size() && static_cast<cell>(lines[i].address) <= address;
+       i++) {
+    last = i;
+  }
+  return lines[last];
+}
+
+AMX_DBG_LINE FindCompact(const AMXLineTable &table, cell address) {
+  AMX_DBG_LINE line;
+  table.Find(address, line);
+  return line;
+}
+
+// Looks up all addresses in a line table once per call.
+template<typename Table, typename Func>
+class LookUpLines {
+ public:
+  LookUpLines(const Table &table, Func find,
+              const std::vector<cell> &addresses)
+   : table_(table), find_(find), addresses_(addresses)
+  {
+  }
+
+  void operator()() {
+    for (std::size_t i = 0; i < addresses_.size(); i++) {
+      sink = find_(table_, addresses_[i]).line;
+    }
+  }
+
+ private:
+  const Table &table_;
+  Func find_;
+  const std::vector<cell> &addresses_;
+};
+
+// Returns nanoseconds per lookup.
+template<typename Table, typename Func>
+double MeasureLookups(const Table &table, Func find,
+                      const std::vector<cell> &addresses) {
+  LookUpLines<Table, Func> lookup(table, find, addresses);
+  return Measure(lookup, kMinTime) * 1000 / addresses.size();
+}
+
+// Statements are a few instructions long; line numbers mostly increase
+// by one, with the occasional jump between functions.
+void GenerateLines(std::vector<AMX_DBG_LINE> &lines) {
+  std::srand(1);
+  AMX_DBG_LINE line = {0, 0};
+  for (int i = 0; i < 65535; i++) {
+    line.address += (2 + std::rand() % 14) * sizeof(cell);
+    line.line += (std::rand() % 16 == 0) ? std::rand() % 64 - 32 : 1;
+    lines.push_back(line);
+  }
+}
+
+bool LoadLines(const char *filename, std::vector<AMX_DBG_LINE> &lines) {
+  std::FILE *fp = std::fopen(filename, "rb");
+  if (fp == 0) {
+    return false;
+  }
+  AMX_DBG amxdbg;
+  int error = dbg_LoadInfo(&amxdbg, fp);
+  std::fclose(fp);
+  if (error != AMX_ERR_NONE) {
+    return false;
+  }
+  lines.assign(amxdbg.linetbl, amxdbg.linetbl + amxdbg.hdr->lines);
+  dbg_FreeInfo(&amxdbg);
+  return true;
+}
+
+bool Run(const std::string &name, const std::vector<AMX_DBG_LINE> &lines) {
+  if (lines.empty()) {
+    std::cerr << name << ": no line table" << std::endl;
+    return false;
+  }
+
+  AMXLineTable table;
+  table.Build(&lines[0], static_cast<int>(lines.size()));
+
+  std::vector<cell> addresses;
+  cell max_address = lines.back().address + sizeof(cell);
+  for (int i = 0; i < kNumLookups; i++) {
+    addresses.push_back(static_cast<cell>(
+      (static_cast<double>(std::rand()) / RAND_MAX) * max_address));
+  }
+
+  for (std::size_t i = 0; i < addresses.size(); i++) {
+    AMX_DBG_LINE expected = FindLinear(lines, addresses[i]);
+    AMX_DBG_LINE actual = FindCompact(table, addresses[i]);
+    if (expected.address != actual.address || expected.line != actual.line) {
+      std::cerr << name << ": wrong line for address " << addresses[i]
+                << std::endl;
+      return false;
+    }
+  }
+
+  std::size_t raw_size = lines.size() * sizeof(AMX_DBG_LINE);
+  std::size_t compact_size = table.GetMemoryUsage();
+  double linear_time = MeasureLookups(lines, FindLinear, addresses);
+  double compact_time = MeasureLookups(table, FindCompact, addresses);
+
+  std::cout << name << ": " << lines.size() << " lines" << std::endl
+            << std::fixed << std::setprecision(1)
+            << "  AMX_DBG_LINE: " << std::setw(9) << raw_size << " bytes "
+            << std::setw(10) << linear_time << " ns/lookup" << std::endl
+            << "  AMXLineTable: " << std::setw(9) << compact_size << " bytes "
+            << std::setw(10) << compact_time << " ns/lookup" << std::endl;
+  return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  bool ok = true;
+  if (argc < 2) {
+    std::vector<AMX_DBG_LINE> lines;
+    GenerateLines(lines);
+    ok = Run("generated", lines);
+  }
+  for (int i = 1; i < argc; i++) {
+    std::vector<AMX_DBG_LINE> lines;
+    if (!LoadLines(argv[i], lines)) {
+      std::cerr << argv[i] << ": could not load debug info" << std::endl;
+      ok = false;
+      continue;
+    }
+    ok = Run(argv[i], lines) && ok;
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,652 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// amxhost - a minimal stand-in for the server: loads plugins and scripts,
+// runs main() and then calls a public function in a loop, ticking plugins
+// after each iteration. Useful for running scripts with CrashDetect without
+// a server.
+//
+// Usage: amxhost [-l <plugin>]... [-n <iterations>] [-p <public>] <script.amx>...
+//
+// Only a few natives are provided: print, printf, format, GetTickCount,
+// CallLocalFunction and SendRconCommand (which exits on "exit").
+
+#include <cctype>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <dlfcn.h>
+#endif
+
+#include <amx/amx.h>
+#include <amx/amxaux.h>
+
+#include "plugin/os.h"
+#include "plugin/plugincommon.h"
+
+namespace {
+
+typedef unsigned int (PLUGIN_CALL *SupportsFunc)();
+typedef bool (PLUGIN_CALL *LoadFunc)(void **ppData);
+typedef void (PLUGIN_CALL *UnloadFunc)();
+typedef int (PLUGIN_CALL *AmxLoadFunc)(AMX *amx);
+typedef int (PLUGIN_CALL *AmxUnloadFunc)(AMX *amx);
+typedef void (PLUGIN_CALL *ProcessTickFunc)();
+
+class Plugin {
+ public:
+  Plugin();
+  ~Plugin();
+
+  bool Load(const std::string &path, void **data);
+  void Unload();
+
+  int AmxLoad(AMX *amx);
+  int AmxUnload(AMX *amx);
+  void ProcessTick();
+
+ private:
+  void *GetSymbol(const char *name) const;
+
+ private:
+  Plugin(const Plugin &);
+  void operator=(const Plugin &);
+
+ private:
+  void *handle_;
+  bool loaded_;
+  unsigned int flags_;
+  UnloadFunc unload_;
+  AmxLoadFunc amx_load_;
+  AmxUnloadFunc amx_unload_;
+  ProcessTickFunc process_tick_;
+};
+
+Plugin::Plugin()
+  : handle_(0),
+    loaded_(false),
+    flags_(0),
+    unload_(0),
+    amx_load_(0),
+    amx_unload_(0),
+    process_tick_(0)
+{
+}
+
+Plugin::~Plugin() {
+  Unload();
+}
+
+bool Plugin::Load(const std::string &path, void **data) {
+  #ifdef _WIN32
+    handle_ = LoadLibraryA(path.c_str());
+  #else
+    handle_ = dlopen(path.c_str(), RTLD_NOW);
+  #endif
+  if (handle_ == 0) {
+    return false;
+  }
+
+  SupportsFunc supports = (SupportsFunc)GetSymbol("Supports");
+  LoadFunc load = (LoadFunc)GetSymbol("Load");
+  if (supports == 0 || load == 0) {
+    return false;
+  }
+
+  flags_ = supports();
+  if ((flags_ & SUPPORTS_VERSION_MASK) > SUPPORTS_VERSION) {
+    return false;
+  }
+
+  unload_ = (UnloadFunc)GetSymbol("Unload");
+  if ((flags_ & SUPPORTS_AMX_NATIVES) != 0) {
+    amx_load_ = (AmxLoadFunc)GetSymbol("AmxLoad");
+    amx_unload_ = (AmxUnloadFunc)GetSymbol("AmxUnload");
+  }
+  if ((flags_ & SUPPORTS_PROCESS_TICK) != 0) {
+    process_tick_ = (ProcessTickFunc)GetSymbol("ProcessTick");
+  }
+
+  loaded_ = load(data);
+  return loaded_;
+}
+
+void Plugin::Unload() {
+  if (loaded_ && unload_ != 0) {
+    unload_();
+  }
+  loaded_ = false;
+  if (handle_ != 0) {
+    #ifdef _WIN32
+      FreeLibrary((HMODULE)handle_);
+    #else
+      dlclose(handle_);
+    #endif
+    handle_ = 0;
+  }
+}
+
+int Plugin::AmxLoad(AMX *amx) {
+  if (loaded_ && amx_load_ != 0) {
+    return amx_load_(amx);
+  }
+  return AMX_ERR_NONE;
+}
+
+int Plugin::AmxUnload(AMX *amx) {
+  if (loaded_ && amx_unload_ != 0) {
+    return amx_unload_(amx);
+  }
+  return AMX_ERR_NONE;
+}
+
+void Plugin::ProcessTick() {
+  if (loaded_ && process_tick_ != 0) {
+    process_tick_();
+  }
+}
+
+void *Plugin::GetSymbol(const char *name) const {
+  #ifdef _WIN32
+    return (void*)GetProcAddress((HMODULE)handle_, name);
+  #else
+    return dlsym(handle_, name);
+  #endif
+}
+
+struct Stats {
+  long num_calls;
+  long num_errors;
+  std::uint64_t load_time;
+};
+
+Stats stats;
+bool exit_requested = false;
+volatile int last_error;
+
+void Logprintf(const char *format, ...) {
+  std::va_list args;
+  va_start(args, format);
+  std::vprintf(format, args);
+  va_end(args);
+  std::printf("\n");
+}
+
+// Plugins hook the Exec and Register entries of the export table by
+// patching the code they point to, so these must be our own functions
+// and not the ones from amx.c that plugins call to get the original
+// behavior. They must also do some work after the call so that they
+// aren't compiled to a jump (which would look like an existing hook).
+// Once hooked their code is never run, so they can't keep statistics.
+
+int AMXAPI HostExec(AMX *amx, cell *retval, int index) {
+  int error = amx_Exec(amx, retval, index);
+  last_error = error;
+  return error;
+}
+
+int AMXAPI HostRegister(AMX *amx, const AMX_NATIVE_INFO *list, int number) {
+  int error = amx_Register(amx, list, number);
+  last_error = error;
+  return error;
+}
+
+void *amx_exports[PLUGIN_AMX_EXPORT_UTF8Put + 1];
+void *plugin_data[256];
+
+// Calls a public function through the export table, so that plugins'
+// hooks see the call.
+int Exec(AMX *amx, cell *retval, int index) {
+  typedef int (AMXAPI *ExecFunc)(AMX *amx, cell *retval, int index);
+  ExecFunc exec = (ExecFunc)amx_exports[PLUGIN_AMX_EXPORT_Exec];
+  int error = exec(amx, retval, index);
+  stats.num_calls++;
+  if (error != AMX_ERR_NONE) {
+    stats.num_errors++;
+  }
+  return error;
+}
+
+// Registers natives through the export table, as the server does.
+int Register(AMX *amx, const AMX_NATIVE_INFO *list, int number) {
+  typedef int (AMXAPI *RegisterFunc)(AMX *amx, const AMX_NATIVE_INFO *list,
+                                     int number);
+  RegisterFunc reg = (RegisterFunc)amx_exports[PLUGIN_AMX_EXPORT_Register];
+  return reg(amx, list, number);
+}
+
+// The bundled amx.c is built without the string functions.
+
+bool IsPackedString(const cell *cstr) {
+  return static_cast<ucell>(*cstr) > UNPACKEDMAX;
+}
+
+char GetPackedChar(const cell *cstr, int index) {
+  ucell c = static_cast<ucell>(cstr[index / sizeof(cell)]);
+  return static_cast<char>(c >> ((sizeof(cell) - 1 - index % sizeof(cell)) * 8));
+}
+
+int AMXAPI HostStrLen(const cell *cstr, int *length) {
+  int i = 0;
+  if (IsPackedString(cstr)) {
+    while (GetPackedChar(cstr, i) != '\0') {
+      i++;
+    }
+  } else {
+    while (cstr[i] != 0) {
+      i++;
+    }
+  }
+  *length = i;
+  return AMX_ERR_NONE;
+}
+
+int AMXAPI HostGetString(char *dest, const cell *source, int use_wchar,
+                         size_t size) {
+  bool packed = IsPackedString(source);
+  size_t i = 0;
+  for (; i + 1 < size; i++) {
+    char c = packed ? GetPackedChar(source, static_cast<int>(i))
+                    : static_cast<char>(source[i]);
+    if (c == '\0') {
+      break;
+    }
+    dest[i] = c;
+  }
+  if (size > 0) {
+    dest[i] = '\0';
+  }
+  return AMX_ERR_NONE;
+}
+
+cell GetCell(AMX *amx, cell address) {
+  cell *ptr;
+  if (amx_GetAddr(amx, address, &ptr) != AMX_ERR_NONE) {
+    return 0;
+  }
+  return *ptr;
+}
+
+std::string GetString(AMX *amx, cell address) {
+  cell *cstr;
+  if (amx_GetAddr(amx, address, &cstr) != AMX_ERR_NONE) {
+    return std::string();
+  }
+  int length;
+  HostStrLen(cstr, &length);
+  std::vector<char> buffer(length + 1);
+  HostGetString(&buffer[0], cstr, 0, buffer.size());
+  return &buffer[0];
+}
+
+// Formats arguments like the server's format(), supporting %d, %i, %s, %f,
+// %c, %x, %b and %%, with optional '-', '0', width and precision.
+std::string Format(AMX *amx, const cell *params, int format_param) {
+  std::string format = GetString(amx, params[format_param]);
+  int num_params = static_cast<int>(params[0] / sizeof(cell));
+  int arg = format_param + 1;
+  std::string result;
+
+  for (std::string::size_type i = 0; i < format.length(); i++) {
+    if (format[i] != '%') {
+      result += format[i];
+      continue;
+    }
+
+    std::string::size_type start = i++;
+    bool left = false;
+    bool zero = false;
+    for (; i < format.length(); i++) {
+      if (format[i] == '-') {
+        left = true;
+      } else if (format[i] == '0') {
+        zero = true;
+      } else {
+        break;
+      }
+    }
+    int width = 0;
+    for (; i < format.length() && std::isdigit(format[i]); i++) {
+      width = width * 10 + (format[i] - '0');
+    }
+    int precision = -1;
+    if (i < format.length() && format[i] == '.') {
+      precision = 0;
+      for (i++; i < format.length() && std::isdigit(format[i]); i++) {
+        precision = precision * 10 + (format[i] - '0');
+      }
+    }
+    if (i >= format.length()) {
+      result.append(format, start, std::string::npos);
+      break;
+    }
+
+    char type = format[i];
+    if (type == '%') {
+      result += '%';
+      continue;
+    }
+    if (arg > num_params) {
+      result.append(format, start, i - start + 1);
+      continue;
+    }
+
+    std::string text;
+    char buffer[64];
+    switch (type) {
+      case 'd':
+      case 'i':
+        std::sprintf(buffer, "%ld", static_cast<long>(GetCell(amx, params[arg++])));
+        text = buffer;
+        break;
+      case 'x':
+        std::sprintf(buffer, "%lX",
+                     static_cast<unsigned long>(GetCell(amx, params[arg++])));
+        text = buffer;
+        break;
+      case 'b': {
+        ucell value = static_cast<ucell>(GetCell(amx, params[arg++]));
+        do {
+          text.insert(text.begin(), static_cast<char>('0' + (value & 1)));
+          value >>= 1;
+        } while (value != 0);
+        break;
+      }
+      case 'c':
+        text = static_cast<char>(GetCell(amx, params[arg++]));
+        break;
+      case 'f': {
+        cell value = GetCell(amx, params[arg++]);
+        if (precision < 0 || precision > 30) {
+          precision = 6;
+        }
+        std::sprintf(buffer, "%.*f", precision, amx_ctof(value));
+        text = buffer;
+        break;
+      }
+      case 's':
+        text = GetString(amx, params[arg++]);
+        if (precision >= 0 && static_cast<int>(text.length()) > precision) {
+          text.resize(precision);
+        }
+        break;
+      default:
+        result.append(format, start, i - start + 1);
+        continue;
+    }
+
+    int padding = width - static_cast<int>(text.length());
+    if (padding > 0) {
+      if (left) {
+        text.append(padding, ' ');
+      } else if (zero && type != 's' && type != 'c') {
+        text.insert(text[0] == '-' ? 1 : 0, padding, '0');
+      } else {
+        text.insert(0, padding, ' ');
+      }
+    }
+    result += text;
+  }
+
+  return result;
+}
+
+namespace natives {
+
+// native print(const string[]);
+cell AMX_NATIVE_CALL print(AMX *amx, cell *params) {
+  Logprintf("%s", GetString(amx, params[1]).c_str());
+  return 0;
+}
+
+// native printf(const format[], {Float,_}:...);
+cell AMX_NATIVE_CALL printf(AMX *amx, cell *params) {
+  Logprintf("%s", Format(amx, params, 1).c_str());
+  return 1;
+}
+
+// native format(output[], len, const format[], {Float,_}:...);
+cell AMX_NATIVE_CALL format(AMX *amx, cell *params) {
+  cell *output;
+  if (amx_GetAddr(amx, params[1], &output) != AMX_ERR_NONE) {
+    return 0;
+  }
+  std::string result = Format(amx, params, 3);
+  return amx_SetString(output, result.c_str(), 0, 0, params[2]) == AMX_ERR_NONE;
+}
+
+// native GetTickCount();
+cell AMX_NATIVE_CALL GetTickCount(AMX *amx, cell *params) {
+  return static_cast<cell>(os::GetMicroseconds() / 1000);
+}
+
+// native CallLocalFunction(const function[], const format[], {Float,_}:...);
+cell AMX_NATIVE_CALL CallLocalFunction(AMX *amx, cell *params) {
+  std::string name = GetString(amx, params[1]);
+  std::string format = GetString(amx, params[2]);
+  int num_params = static_cast<int>(params[0] / sizeof(cell));
+
+  int index;
+  if (amx_FindPublic(amx, name.c_str(), &index) != AMX_ERR_NONE) {
+    return 0;
+  }
+
+  cell heap = amx->hea;
+  for (int i = static_cast<int>(format.length()) - 1; i >= 0; i--) {
+    if (3 + i > num_params) {
+      continue;
+    }
+    if (format[i] == 's') {
+      cell address;
+      amx_PushString(amx, &address, 0,
+                     GetString(amx, params[3 + i]).c_str(), 0, 0);
+    } else {
+      amx_Push(amx, GetCell(amx, params[3 + i]));
+    }
+  }
+
+  cell retval = 0;
+  Exec(amx, &retval, index);
+  amx_Release(amx, heap);
+  return retval;
+}
+
+// native SendRconCommand(const command[]);
+cell AMX_NATIVE_CALL SendRconCommand(AMX *amx, cell *params) {
+  if (GetString(amx, params[1]) == "exit") {
+    exit_requested = true;
+  }
+  return 1;
+}
+
+const AMX_NATIVE_INFO list[] = {
+  {"print",             natives::print},
+  {"printf",            natives::printf},
+  {"format",            natives::format},
+  {"GetTickCount",      natives::GetTickCount},
+  {"CallLocalFunction", natives::CallLocalFunction},
+  {"SendRconCommand",   natives::SendRconCommand}
+};
+
+} // namespace natives
+
+void InitPluginData() {
+  amx_exports[PLUGIN_AMX_EXPORT_Align16] = (void*)amx_Align16;
+  amx_exports[PLUGIN_AMX_EXPORT_Align32] = (void*)amx_Align32;
+  amx_exports[PLUGIN_AMX_EXPORT_Allot] = (void*)amx_Allot;
+  amx_exports[PLUGIN_AMX_EXPORT_Callback] = (void*)amx_Callback;
+  amx_exports[PLUGIN_AMX_EXPORT_Cleanup] = (void*)amx_Cleanup;
+  amx_exports[PLUGIN_AMX_EXPORT_Exec] = (void*)HostExec;
+  amx_exports[PLUGIN_AMX_EXPORT_FindNative] = (void*)amx_FindNative;
+  amx_exports[PLUGIN_AMX_EXPORT_FindPublic] = (void*)amx_FindPublic;
+  amx_exports[PLUGIN_AMX_EXPORT_Flags] = (void*)amx_Flags;
+  amx_exports[PLUGIN_AMX_EXPORT_GetAddr] = (void*)amx_GetAddr;
+  amx_exports[PLUGIN_AMX_EXPORT_GetNative] = (void*)amx_GetNative;
+  amx_exports[PLUGIN_AMX_EXPORT_GetPublic] = (void*)amx_GetPublic;
+  amx_exports[PLUGIN_AMX_EXPORT_GetString] = (void*)HostGetString;
+  amx_exports[PLUGIN_AMX_EXPORT_GetUserData] = (void*)amx_GetUserData;
+  amx_exports[PLUGIN_AMX_EXPORT_Init] = (void*)amx_Init;
+  amx_exports[PLUGIN_AMX_EXPORT_NumNatives] = (void*)amx_NumNatives;
+  amx_exports[PLUGIN_AMX_EXPORT_NumPublics] = (void*)amx_NumPublics;
+  amx_exports[PLUGIN_AMX_EXPORT_Push] = (void*)amx_Push;
+  amx_exports[PLUGIN_AMX_EXPORT_PushArray] = (void*)amx_PushArray;
+  amx_exports[PLUGIN_AMX_EXPORT_PushString] = (void*)amx_PushString;
+  amx_exports[PLUGIN_AMX_EXPORT_Register] = (void*)HostRegister;
+  amx_exports[PLUGIN_AMX_EXPORT_Release] = (void*)amx_Release;
+  amx_exports[PLUGIN_AMX_EXPORT_SetCallback] = (void*)amx_SetCallback;
+  amx_exports[PLUGIN_AMX_EXPORT_SetDebugHook] = (void*)amx_SetDebugHook;
+  amx_exports[PLUGIN_AMX_EXPORT_SetString] = (void*)amx_SetString;
+  amx_exports[PLUGIN_AMX_EXPORT_SetUserData] = (void*)amx_SetUserData;
+  amx_exports[PLUGIN_AMX_EXPORT_StrLen] = (void*)HostStrLen;
+
+  plugin_data[PLUGIN_DATA_LOGPRINTF] = (void*)Logprintf;
+  plugin_data[PLUGIN_DATA_AMX_EXPORTS] = amx_exports;
+}
+
+struct Script {
+  AMX *amx;
+  std::string path;
+};
+
+void ReportError(const std::string &filename, int error) {
+  if (error != AMX_ERR_NONE) {
+    Logprintf("Script[%s]: Run time error %d: \"%s\"",
+              filename.c_str(), error, aux_StrError(error));
+  }
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::string> plugin_paths;
+  std::vector<std::string> script_paths;
+  long iterations = 1;
+  std::string public_name;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+      plugin_paths.push_back(argv[++i]);
+    } else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      iterations = std::strtol(argv[++i], 0, 10);
+    } else if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+      public_name = argv[++i];
+    } else {
+      script_paths.push_back(argv[i]);
+    }
+  }
+
+  if (script_paths.empty()) {
+    std::cerr << "Usage: " << argv[0] << " [-l <plugin>]... [-n <iterations>]"
+              << " [-p <public>] <script.amx>..." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  InitPluginData();
+
+  std::vector<Plugin*> plugins;
+  for (std::size_t i = 0; i < plugin_paths.size(); i++) {
+    Logprintf(" Loading plugin: %s", plugin_paths[i].c_str());
+    Plugin *plugin = new Plugin;
+    if (plugin->Load(plugin_paths[i], plugin_data)) {
+      Logprintf("  Loaded.");
+    } else {
+      Logprintf("  Failed.");
+    }
+    plugins.push_back(plugin);
+  }
+
+  std::vector<Script> scripts;
+  for (std::size_t i = 0; i < script_paths.size(); i++) {
+    Script script = {new AMX, script_paths[i]};
+    AMX *amx = script.amx;
+    std::memset(amx, 0, sizeof(*amx));
+    int error = aux_LoadProgram(amx, script.path.c_str(), 0);
+    if (error != AMX_ERR_NONE) {
+      Logprintf("Could not load %s: %s", script.path.c_str(),
+                aux_StrError(error));
+      delete amx;
+      continue;
+    }
+    std::uint64_t load_start_time = os::GetMicroseconds();
+    Register(amx, natives::list, sizeof(natives::list) /
+                                 sizeof(natives::list[0]));
+    for (std::size_t j = 0; j < plugins.size(); j++) {
+      plugins[j]->AmxLoad(amx);
+    }
+    stats.load_time += os::GetMicroseconds() - load_start_time;
+    scripts.push_back(script);
+
+    AMX_HEADER *hdr = reinterpret_cast<AMX_HEADER*>(amx->base);
+    if (hdr->cip >= 0 && !exit_requested) {
+      cell retval;
+      ReportError(script.path, Exec(amx, &retval, AMX_EXEC_MAIN));
+    }
+  }
+
+  std::uint64_t start_time = os::GetMicroseconds();
+  long n = 0;
+  for (; n < iterations && !exit_requested; n++) {
+    if (!public_name.empty()) {
+      for (std::size_t i = 0; i < scripts.size(); i++) {
+        int index;
+        if (amx_FindPublic(scripts[i].amx, public_name.c_str(), &index)
+            == AMX_ERR_NONE) {
+          cell retval;
+          ReportError(scripts[i].path,
+                      Exec(scripts[i].amx, &retval, index));
+        }
+      }
+    }
+    for (std::size_t i = 0; i < plugins.size(); i++) {
+      plugins[i]->ProcessTick();
+    }
+  }
+  std::uint64_t loop_time = os::GetMicroseconds() - start_time;
+
+  for (std::size_t i = 0; i < scripts.size(); i++) {
+    for (std::size_t j = 0; j < plugins.size(); j++) {
+      plugins[j]->AmxUnload(scripts[i].amx);
+    }
+    aux_FreeProgram(scripts[i].amx);
+    delete scripts[i].amx;
+  }
+  for (std::size_t i = 0; i < plugins.size(); i++) {
+    delete plugins[i];
+  }
+
+  std::fflush(stdout);
+  std::fprintf(stderr, "%ld iterations in %.3f ms, %ld calls, %ld errors, "
+               "scripts loaded in %.3f ms\n",
+               n, loop_time / 1000.0, stats.num_calls, stats.num_errors,
+               stats.load_time / 1000.0);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,252 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// amxmembench - measures the throughput of the block instructions MOVS,
+// FILL and CMPS in the bundled interpreter on blocks of 1 KB to 1 MB and
+// compares it with memcpy(), memset() and memcmp() on the same blocks.
+//
+// Usage: amxmembench
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <amx/amx.h>
+
+#include "plugin/amxopcode.h"
+
+#include "benchmark.h"
+
+namespace {
+
+const cell kMaxBlockSize = 1024 * 1024;
+const cell kStackSize = 4096;
+const cell kFillValue = 0x12345678;
+
+// Enough work per call to make the amx_Exec() overhead negligible.
+const cell kBytesPerExec = 16 * 1024 * 1024;
+
+const std::uint64_t kMinTime = 200000; // microseconds
+
+volatile cell sink;
+
+// Builds a script with no publics or natives whose main() executes the
+// given instruction kBytesPerExec / size times. The source block is at the
+// start of the data section and the destination block right after it.
+std::vector<unsigned char> BuildScript(AMXOpcode opcode, cell size,
+                                       cell value) {
+  const cell kHeaderSize = sizeof(AMX_HEADER);
+  const cell kNameTableSize = sizeof(uint16_t);
+  const cell src = 0;
+  const cell dst = kMaxBlockSize;
+
+  std::vector<cell> code;
+  code.push_back(AMX_OP_HALT);           // return address of main()
+  code.push_back(0);
+  cell main = static_cast<cell>(code.size() * sizeof(cell));
+  code.push_back(AMX_OP_PROC);
+  code.push_back(AMX_OP_PUSH_C);
+  code.push_back(kBytesPerExec / size);
+  cell loop = static_cast<cell>(code.size() * sizeof(cell));
+  code.push_back(AMX_OP_CONST_PRI);
+  code.push_back(opcode == AMX_OP_FILL ? value : src);
+  code.push_back(AMX_OP_CONST_ALT);
+  code.push_back(dst);
+  code.push_back(opcode);
+  code.push_back(size);
+  code.push_back(AMX_OP_DEC_S);
+  code.push_back(-static_cast<cell>(sizeof(cell)));
+  code.push_back(AMX_OP_LOAD_S_PRI);
+  code.push_back(-static_cast<cell>(sizeof(cell)));
+  code.push_back(AMX_OP_JNZ);
+  code.push_back(loop);
+  code.push_back(AMX_OP_STACK);
+  code.push_back(sizeof(cell));
+  code.push_back(AMX_OP_RETN);
+
+  cell cod = (kHeaderSize + kNameTableSize + sizeof(cell) - 1)
+             & ~static_cast<cell>(sizeof(cell) - 1);
+  cell dat = cod + static_cast<cell>(code.size() * sizeof(cell));
+  cell hea = dat + 2 * kMaxBlockSize;
+  cell stp = hea + kStackSize;
+
+  std::vector<unsigned char> script(stp);
+  AMX_HEADER *hdr = reinterpret_cast<AMX_HEADER*>(&script[0]);
+  hdr->size = hea;
+  hdr->magic = AMX_MAGIC;
+  hdr->file_version = CUR_FILE_VERSION;
+  hdr->amx_version = MIN_AMX_VERSION;
+  hdr->flags = 0;
+  hdr->defsize = sizeof(AMX_FUNCSTUBNT);
+  hdr->cod = cod;
+  hdr->dat = dat;
+  hdr->hea = hea;
+  hdr->stp = stp;
+  hdr->cip = main;
+  hdr->publics = kHeaderSize;
+  hdr->natives = kHeaderSize;
+  hdr->libraries = kHeaderSize;
+  hdr->pubvars = kHeaderSize;
+  hdr->tags = kHeaderSize;
+  hdr->nametable = kHeaderSize;
+  *reinterpret_cast<uint16_t*>(&script[kHeaderSize]) = sNAMEMAX;
+  std::memcpy(&script[cod], &code[0], code.size() * sizeof(cell));
+  return script;
+}
+
+// Returns bytes processed per second, in GB, given the time it takes to
+// process kBytesPerExec bytes in blocks of the given size.
+double Throughput(cell size, double time) {
+  double bytes = static_cast<double>(kBytesPerExec / size) * size;
+  return bytes / (time / 1e6) / 1e9;
+}
+
+// Runs main() of a script built by BuildScript() once per call.
+class ExecScript {
+ public:
+  explicit ExecScript(AMX *amx) : amx_(amx) {}
+
+  void operator()() {
+    cell retval;
+    int error = amx_Exec(amx_, &retval, AMX_EXEC_MAIN);
+    if (error != AMX_ERR_NONE) {
+      std::cerr << "amx_Exec() failed with error " << error << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    sink = amx_->pri;
+  }
+
+ private:
+  AMX *amx_;
+};
+
+double MeasureInstruction(AMXOpcode opcode, cell size, cell value) {
+  std::vector<unsigned char> script = BuildScript(opcode, size, value);
+  AMX amx;
+  std::memset(&amx, 0, sizeof(amx));
+  if (amx_Init(&amx, &script[0]) != AMX_ERR_NONE
+      || amx_Register(&amx, 0, 0) != AMX_ERR_NONE) {
+    std::cerr << "Could not load the script" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  ExecScript exec(&amx);
+  double time = Measure(exec, kMinTime);
+
+  amx_Cleanup(&amx);
+  return Throughput(size, time);
+}
+
+enum Reference {
+  kMemcpy,
+  kMemset,
+  kFillLoop,
+  kMemcmp
+};
+
+// The same work done in plain C++. kFillLoop is how FILL used to be
+// implemented: one cell at a time.
+class RunReference {
+ public:
+  RunReference(Reference reference, cell size)
+   : reference_(reference),
+     size_(size),
+     src_(size / sizeof(cell)),
+     dst_(size / sizeof(cell)),
+     count_(0)
+  {
+  }
+
+  void operator()() {
+    std::size_t cells = src_.size();
+    for (cell i = 0; i < kBytesPerExec / size_; i++) {
+      switch (reference_) {
+        case kMemcpy:
+          std::memcpy(&dst_[0], &src_[0], size_);
+          break;
+        case kMemset:
+          std::memset(&dst_[0], 0, size_);
+          break;
+        case kFillLoop: {
+          volatile cell *p = &dst_[0];
+          for (std::size_t j = 0; j < cells; j++) {
+            p[j] = kFillValue;
+          }
+          break;
+        }
+        case kMemcmp:
+          sink = std::memcmp(&dst_[0], &src_[0], size_);
+          break;
+      }
+    }
+    sink = dst_[count_++ % cells];
+  }
+
+ private:
+  Reference reference_;
+  cell size_;
+  std::vector<cell> src_;
+  std::vector<cell> dst_;
+  std::size_t count_;
+};
+
+double MeasureReference(Reference reference, cell size) {
+  RunReference run(reference, size);
+  return Throughput(size, Measure(run, kMinTime));
+}
+
+} // anonymous namespace
+
+int main() {
+  std::cout << "Throughput, GB/s" << std::endl
+            << std::setw(8) << "size"
+            << std::setw(8) << "MOVS"
+            << std::setw(8) << "memcpy"
+            << std::setw(8) << "FILL 0"
+            << std::setw(8) << "memset"
+            << std::setw(8) << "FILL x"
+            << std::setw(8) << "loop x"
+            << std::setw(8) << "CMPS"
+            << std::setw(8) << "memcmp"
+            << std::endl;
+
+  for (cell size = 1024; size <= kMaxBlockSize; size *= 4) {
+    std::cout << std::setw(7) << size / 1024 << "K" << std::fixed
+              << std::setprecision(2)
+              << std::setw(8) << MeasureInstruction(AMX_OP_MOVS, size, 0)
+              << std::setw(8) << MeasureReference(kMemcpy, size)
+              << std::setw(8) << MeasureInstruction(AMX_OP_FILL, size, 0)
+              << std::setw(8) << MeasureReference(kMemset, size)
+              << std::setw(8) << MeasureInstruction(AMX_OP_FILL, size,
+                                                    kFillValue)
+              << std::setw(8) << MeasureReference(kFillLoop, size)
+              << std::setw(8) << MeasureInstruction(AMX_OP_CMPS, size, 0)
+              << std::setw(8) << MeasureReference(kMemcmp, size)
+              << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// amxopstat - counts how often opcodes and pairs of adjacent opcodes occur
+// in the given scripts. Pairs marked with '*' are already replaced with
+// superinstructions at load time (crashdetect_superinstructions).
+//
+// Usage: amxopstat [-n <count>] <script.amx>...
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <amx/amx.h>
+#include <amx/amxaux.h>
+
+#include "plugin/amxdisasm.h"
+#include "plugin/amxopcode.h"
+#include "plugin/amxscript.h"
+
+namespace {
+
+typedef std::pair<AMXOpcode, AMXOpcode> OpcodePair;
+
+// Debug opcodes are skipped: they are never executed (or do nothing).
+bool IsIgnored(AMXOpcode opcode) {
+  switch (opcode) {
+    case AMX_OP_FILE:
+    case AMX_OP_LINE:
+    case AMX_OP_SYMBOL:
+    case AMX_OP_SRANGE:
+    case AMX_OP_SYMTAG:
+    case AMX_OP_BREAK:
+      return true;
+    default:
+      return false;
+  }
+}
+
+template<typename Key>
+std::vector<std::pair<long, Key> > SortByCount(const std::map<Key, long> &counts) {
+  std::vector<std::pair<long, Key> > sorted;
+  for (typename std::map<Key, long>::const_iterator it = counts.begin();
+       it != counts.end(); ++it) {
+    sorted.push_back(std::make_pair(it->second, it->first));
+  }
+  std::sort(sorted.rbegin(), sorted.rend());
+  return sorted;
+}
+
+const char *GetName(AMXOpcode opcode) {
+  const AMXOpcodeInfo *info = GetAmxOpcodeInfo(opcode);
+  return info != 0 ? info->name : "?";
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  std::size_t max_lines = 20;
+  std::map<AMXOpcode, long> opcodes;
+  std::map<OpcodePair, long> pairs;
+  long total = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      max_lines = std::strtoul(argv[++i], 0, 10);
+      continue;
+    }
+
+    AMX amx;
+    if (aux_LoadProgram(&amx, argv[i], 0) != AMX_ERR_NONE) {
+      std::cerr << "Could not load " << argv[i] << std::endl;
+      continue;
+    }
+
+    AMXDisassembler disas(&amx);
+    AMXInstruction instr;
+    AMXOpcode prev_opcode = AMX_OP_NONE;
+
+    while (disas.Decode(instr)) {
+      if (IsIgnored(instr.opcode())) {
+        continue;
+      }
+      opcodes[instr.opcode()]++;
+      if (prev_opcode != AMX_OP_NONE) {
+        pairs[std::make_pair(prev_opcode, instr.opcode())]++;
+      }
+      prev_opcode = instr.opcode();
+      total++;
+    }
+
+    aux_FreeProgram(&amx);
+  }
+
+  if (total == 0) {
+    std::cerr << "Usage: " << argv[0] << " [-n <count>] <script.amx>..."
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << std::fixed << std::setprecision(2);
+
+  std::cout << "Opcodes (" << total << " instructions):" << std::endl;
+  std::vector<std::pair<long, AMXOpcode> > sorted_opcodes = SortByCount(opcodes);
+  for (std::size_t i = 0; i < sorted_opcodes.size() && i < max_lines; i++) {
+    long count = sorted_opcodes[i].first;
+    std::cout << std::setw(8) << count << " "
+              << std::setw(6) << 100.0 * count / total << "%  "
+              << GetName(sorted_opcodes[i].second) << std::endl;
+  }
+
+  std::cout << std::endl << "Pairs:" << std::endl;
+  std::vector<std::pair<long, OpcodePair> > sorted_pairs = SortByCount(pairs);
+  for (std::size_t i = 0; i < sorted_pairs.size() && i < max_lines; i++) {
+    long count = sorted_pairs[i].first;
+    const OpcodePair &pair = sorted_pairs[i].second;
+    bool fused = FindAmxSuperinstruction(pair.first, pair.second) != 0;
+    std::cout << std::setw(8) << count << " "
+              << std::setw(6) << 100.0 * count / total << "% "
+              << (fused ? "*" : " ") << " "
+              << GetName(pair.first) << " / " << GetName(pair.second)
+              << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
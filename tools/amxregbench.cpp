@@ -0,0 +1,225 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// amxregbench - measures how long it takes to register the natives of all
+// plugins with a script: amx_Register() from amx.c versus the hashed
+// lookup CrashDetect uses instead (AMXNativeList).
+//
+// Usage: amxregbench [<plugins> [<natives per plugin> [<script natives>]]]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <amx/amx.h>
+
+#include "plugin/amxnativelist.h"
+
+#include "benchmark.h"
+
+namespace {
+
+const std::uint64_t kMinTime = 500000; // microseconds
+
+typedef int (*RegisterFunc)(AMX *amx, const AMX_NATIVE_INFO *natives,
+                            int number);
+
+cell AMX_NATIVE_CALL Dummy(AMX *amx, cell *params) {
+  return 0;
+}
+
+class Benchmark {
+ public:
+  Benchmark(int num_plugins, int natives_per_plugin, int script_natives);
+
+  void Load(RegisterFunc func);
+
+  // Returns the time it takes to register all natives, in milliseconds.
+  double Measure(RegisterFunc func);
+
+ private:
+  void BuildScript(int count);
+
+ private:
+  std::vector<std::string> names_;
+  std::vector<std::vector<AMX_NATIVE_INFO> > lists_;
+  std::vector<unsigned char> script_;
+  AMX amx_;
+};
+
+Benchmark::Benchmark(int num_plugins, int natives_per_plugin,
+                     int script_natives) {
+  names_.reserve(num_plugins * natives_per_plugin);
+  for (int i = 0; i < num_plugins; i++) {
+    for (int j = 0; j < natives_per_plugin; j++) {
+      char name[sNAMEMAX + 1];
+      std::sprintf(name, "Plugin%d_Native%d", i, j);
+      names_.push_back(name);
+    }
+  }
+
+  lists_.resize(num_plugins);
+  for (int i = 0; i < num_plugins; i++) {
+    for (int j = 0; j < natives_per_plugin; j++) {
+      AMX_NATIVE_INFO info = {
+        names_[i * natives_per_plugin + j].c_str(),
+        Dummy
+      };
+      lists_[i].push_back(info);
+    }
+    AMX_NATIVE_INFO end = {0, 0};
+    lists_[i].push_back(end);
+  }
+
+  BuildScript(script_natives);
+}
+
+// The script only has a header and a native table that refers to randomly
+// chosen natives of the plugins.
+void Benchmark::BuildScript(int count) {
+  const int kHeaderSize = sizeof(AMX_HEADER);
+  int natives_size = count * sizeof(AMX_FUNCSTUBNT);
+  int nametable = kHeaderSize + natives_size;
+
+  std::vector<unsigned char> names(sizeof(uint16_t));
+  *reinterpret_cast<uint16_t*>(&names[0]) = sNAMEMAX;
+  std::vector<uint32_t> name_offsets;
+  std::srand(1);
+  for (int i = 0; i < count; i++) {
+    const std::string &name = names_[std::rand() % names_.size()];
+    name_offsets.push_back(nametable + static_cast<uint32_t>(names.size()));
+    names.insert(names.end(), name.begin(), name.end());
+    names.push_back('\0');
+  }
+
+  script_.assign(nametable + names.size(), 0);
+  AMX_HEADER *hdr = reinterpret_cast<AMX_HEADER*>(&script_[0]);
+  hdr->size = static_cast<int32_t>(script_.size());
+  hdr->magic = AMX_MAGIC;
+  hdr->file_version = CUR_FILE_VERSION;
+  hdr->amx_version = MIN_AMX_VERSION;
+  hdr->defsize = sizeof(AMX_FUNCSTUBNT);
+  hdr->natives = kHeaderSize;
+  hdr->libraries = kHeaderSize + natives_size;
+  hdr->pubvars = hdr->libraries;
+  hdr->tags = hdr->libraries;
+  hdr->nametable = nametable;
+
+  AMX_FUNCSTUBNT *natives =
+    reinterpret_cast<AMX_FUNCSTUBNT*>(&script_[kHeaderSize]);
+  for (int i = 0; i < count; i++) {
+    natives[i].address = 0;
+    natives[i].nameofs = name_offsets[i];
+  }
+  std::memcpy(&script_[nametable], &names[0], names.size());
+
+  std::memset(&amx_, 0, sizeof(amx_));
+  amx_.base = &script_[0];
+}
+
+// Does what the server does when a script is loaded: every plugin
+// registers its natives in turn.
+void Benchmark::Load(RegisterFunc func) {
+  AMX_HEADER *hdr = reinterpret_cast<AMX_HEADER*>(amx_.base);
+  AMX_FUNCSTUBNT *natives =
+    reinterpret_cast<AMX_FUNCSTUBNT*>(amx_.base + hdr->natives);
+  int count = (hdr->libraries - hdr->natives) / hdr->defsize;
+  for (int i = 0; i < count; i++) {
+    natives[i].address = 0;
+  }
+  amx_.flags = 0;
+
+  int error = AMX_ERR_NONE;
+  for (std::size_t i = 0; i < lists_.size(); i++) {
+    error = func(&amx_, &lists_[i][0], -1);
+  }
+  if (error != AMX_ERR_NONE) {
+    std::cerr << "Some natives were not registered" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+// Loads the script once per call.
+class LoadScript {
+ public:
+  LoadScript(Benchmark &benchmark, RegisterFunc func)
+   : benchmark_(benchmark), func_(func)
+  {
+  }
+
+  void operator()() {
+    benchmark_.Load(func_);
+  }
+
+ private:
+  Benchmark &benchmark_;
+  RegisterFunc func_;
+};
+
+double Benchmark::Measure(RegisterFunc func) {
+  LoadScript load(*this, func);
+  return ::Measure(load, kMinTime) / 1000;
+}
+
+int AMXAPI RegisterLinear(AMX *amx, const AMX_NATIVE_INFO *natives,
+                          int number) {
+  return amx_Register(amx, natives, number);
+}
+
+int AMXAPI RegisterHashed(AMX *amx, const AMX_NATIVE_INFO *natives,
+                          int number) {
+  return AMXNativeList::Register(amx, natives, number);
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  int num_plugins = argc > 1 ? std::atoi(argv[1]) : 30;
+  int natives_per_plugin = argc > 2 ? std::atoi(argv[2]) : 100;
+  int script_natives = argc > 3 ? std::atoi(argv[3]) : 1500;
+  if (num_plugins <= 0 || natives_per_plugin <= 0 || script_natives <= 0) {
+    std::cerr << "Usage: amxregbench [<plugins> [<natives per plugin> "
+                 "[<script natives>]]]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Benchmark benchmark(num_plugins, natives_per_plugin, script_natives);
+  double linear = benchmark.Measure(RegisterLinear);
+  double hashed = benchmark.Measure(RegisterHashed);
+
+  std::cout << num_plugins << " plugins, " << natives_per_plugin
+            << " natives each, " << script_natives << " natives in script"
+            << std::endl << std::fixed << std::setprecision(3)
+            << "amx_Register:  " << std::setw(10) << linear << " ms"
+            << std::endl
+            << "AMXNativeList: " << std::setw(10) << hashed << " ms"
+            << std::endl
+            << "speedup:       " << std::setw(10) << std::setprecision(1)
+            << linear / hashed << "x" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// amxstrbench - measures how long amx_StrLen(), amx_GetString() and
+// amx_SetString() take on unpacked strings of different lengths with each
+// of the implementations in plugin/amxstring.cpp supported by this CPU.
+//
+// Usage: amxstrbench [<length>...]
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <amx/amx.h>
+
+#include "plugin/amxstring.h"
+
+#include "benchmark.h"
+
+namespace {
+
+const int kDefaultLengths[] = {4, 16, 64, 256, 1024, 4096};
+const std::uint64_t kMinTime = 200000; // microseconds
+
+// Anything that depends on the results, so that the calls are not
+// optimized away.
+volatile cell sink;
+
+enum Operation {
+  kStrLen,
+  kGetString,
+  kSetString
+};
+
+const char *GetOperationName(Operation op) {
+  switch (op) {
+    case kStrLen:
+      return "StrLen";
+    case kGetString:
+      return "GetString";
+    case kSetString:
+      return "SetString";
+  }
+  return "?";
+}
+
+// Runs the operation on a string of the given length kBatchSize times per
+// call.
+class RunOperation {
+ public:
+  static const int kBatchSize = 1000;
+
+  RunOperation(Operation op, int length)
+   : op_(op), cells_(length + 1), chars_(length + 1)
+  {
+    for (int i = 0; i < length; i++) {
+      cells_[i] = 'a' + i % 26;
+      chars_[i] = static_cast<char>('a' + i % 26);
+    }
+  }
+
+  void operator()() {
+    for (int i = 0; i < kBatchSize; i++) {
+      switch (op_) {
+        case kStrLen: {
+          int n;
+          amxstring::StrLen(&cells_[0], &n);
+          sink = n;
+          break;
+        }
+        case kGetString:
+          amxstring::GetString(&chars_[0], &cells_[0], 0, chars_.size());
+          sink = chars_[i % chars_.size()];
+          break;
+        case kSetString:
+          amxstring::SetString(&cells_[0], &chars_[0], 0, 0, cells_.size());
+          sink = cells_[i % cells_.size()];
+          break;
+      }
+    }
+  }
+
+ private:
+  Operation op_;
+  std::vector<cell> cells_;
+  std::vector<char> chars_;
+};
+
+// Returns nanoseconds per call.
+double MeasureOperation(Operation op, int length) {
+  RunOperation run(op, length);
+  return Measure(run, kMinTime) * 1000 / RunOperation::kBatchSize;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  std::vector<int> lengths;
+  for (int i = 1; i < argc; i++) {
+    int length = std::atoi(argv[i]);
+    if (length <= 0) {
+      std::cerr << "Usage: amxstrbench [<length>...]" << std::endl;
+      return EXIT_FAILURE;
+    }
+    lengths.push_back(length);
+  }
+  if (lengths.empty()) {
+    lengths.assign(kDefaultLengths, kDefaultLengths
+                   + sizeof(kDefaultLengths) / sizeof(*kDefaultLengths));
+  }
+
+  amxstring::Mode supported = amxstring::GetSupportedMode();
+  std::cout << "Best supported mode: "
+            << amxstring::GetModeName(supported) << std::endl
+            << "Time per call, ns" << std::endl;
+
+  std::cout << std::setw(10) << "" << std::setw(8) << "length";
+  for (int mode = amxstring::kScalar; mode <= supported; mode++) {
+    std::cout << std::setw(10)
+              << amxstring::GetModeName(static_cast<amxstring::Mode>(mode));
+  }
+  std::cout << std::setw(10) << "speedup" << std::endl;
+
+  for (int op = kStrLen; op <= kSetString; op++) {
+    for (std::size_t i = 0; i < lengths.size(); i++) {
+      std::cout << std::setw(10) << GetOperationName(static_cast<Operation>(op))
+                << std::setw(8) << lengths[i];
+      double scalar_time = 0;
+      double best_time = 0;
+      for (int mode = amxstring::kScalar; mode <= supported; mode++) {
+        amxstring::SetMode(static_cast<amxstring::Mode>(mode));
+        double time = MeasureOperation(static_cast<Operation>(op),
+                                       lengths[i]);
+        if (mode == amxstring::kScalar) {
+          scalar_time = time;
+        }
+        best_time = time;
+        std::cout << std::setw(10) << std::fixed << std::setprecision(1)
+                  << time;
+      }
+      std::cout << std::setw(9) << std::setprecision(2)
+                << scalar_time / best_time << "x" << std::endl;
+    }
+  }
+
+  amxstring::SetMode(supported);
+  return EXIT_SUCCESS;
+}
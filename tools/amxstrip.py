@@ -0,0 +1,75 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2013 Zeex
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# 1. Redistributions of source code must retain the above copyright notice,
+#    this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+
+# Moves debug info out of a compiled script so that the script can be shipped
+# without it. The original file is kept as <script>.amx.dbg, where CrashDetect
+# will find it (see crashdetect_symbol_path), and the script is cut off at the
+# end of its code and data.
+
+import argparse
+import os
+import shutil
+import struct
+import sys
+
+AMX_MAGIC = 0xf1e0
+AMX_FLAG_DEBUG = 0x02
+
+def strip(filename, debug_filename):
+  with open(filename, 'rb') as f:
+    data = f.read()
+  size, magic, file_version, amx_version, flags = struct.unpack_from('<iHBBh', data)
+  if magic != AMX_MAGIC:
+    raise ValueError('%s is not an AMX file' % filename)
+  if not flags & AMX_FLAG_DEBUG or len(data) <= size:
+    raise ValueError('%s has no debug info' % filename)
+  shutil.copyfile(filename, debug_filename)
+  header = struct.pack('<iHBBh', size, magic, file_version, amx_version,
+                       flags & ~AMX_FLAG_DEBUG)
+  with open(filename, 'wb') as f:
+    f.write(header + data[len(header):size])
+
+def main(argv):
+  arg_parser = argparse.ArgumentParser()
+  arg_parser.add_argument('amx', nargs='+', help='script compiled with -d2 or -d3')
+  arg_parser.add_argument('-o', '--output-dir', help='write .amx.dbg files to this directory')
+  args = arg_parser.parse_args(argv[1:])
+
+  status = 0
+  for filename in args.amx:
+    debug_filename = filename + '.dbg'
+    if args.output_dir is not None:
+      debug_filename = os.path.join(args.output_dir,
+                                    os.path.basename(debug_filename))
+    try:
+      strip(filename, debug_filename)
+    except (IOError, ValueError) as e:
+      sys.stderr.write("%s\n" % e)
+      status = 1
+  sys.exit(status)
+
+if __name__ == '__main__':
+  main(sys.argv)
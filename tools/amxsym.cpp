@@ -0,0 +1,207 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// amxsym - symbolizes AMX backtraces printed with crashdetect_raw_backtrace.
+//
+// Usage: amxsym <script.amx>... < server_log.txt
+//
+// Backtrace frames are matched against the given scripts by fingerprint and
+// rewritten using the debug info from the .amx files. Everything else is
+// passed through unchanged.
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <amx/amx.h>
+#include <amx/amxaux.h>
+
+#include "plugin/amxdebuginfo.h"
+#include "plugin/amxdisasm.h"
+#include "plugin/amxscript.h"
+#include "plugin/amxstacktrace.h"
+
+namespace {
+
+struct Script {
+  AMX amx;
+  AMXDebugInfo debug_info;
+};
+
+typedef std::map<uint32_t, Script*> ScriptMap;
+
+Script *LoadScript(const char *filename) {
+  Script *script = new Script;
+  if (aux_LoadProgram(&script->amx, filename, 0) != AMX_ERR_NONE) {
+    delete script;
+    return 0;
+  }
+  if (AMXDebugInfo::IsPresent(&script->amx)) {
+    script->debug_info.Load(filename);
+  }
+  return script;
+}
+
+void FreeScript(Script *script) {
+  aux_FreeProgram(&script->amx);
+  delete script;
+}
+
+bool ParseFingerprint(const std::string &line, uint32_t &fingerprint) {
+  static const char kHeader[] = "AMX backtrace (fingerprint ";
+  std::string::size_type pos = line.find(kHeader);
+  if (pos == std::string::npos) {
+    return false;
+  }
+  unsigned int value;
+  if (std::sscanf(line.c_str() + pos + sizeof(kHeader) - 1, "%8x", &value) != 1) {
+    return false;
+  }
+  fingerprint = value;
+  return true;
+}
+
+// Parses a "#<level> <return address> @<caller address>" frame. The return
+// address is "????????" for the entry point. On success [begin, end) is the
+// part of the line that should be replaced with the symbolized frame.
+bool ParseFrame(const std::string &line,
+                std::string::size_type &begin,
+                std::string::size_type &end,
+                cell &return_address,
+                cell &caller_address) {
+  std::string::size_type hash = line.find('#');
+  if (hash == std::string::npos) {
+    return false;
+  }
+
+  int level;
+  char ret[9];
+  unsigned int caller;
+  int frame_begin = 0;
+  int frame_end = 0;
+  if (std::sscanf(line.c_str() + hash, "#%d %n%8[0-9a-f?] @%8x%n",
+                  &level, &frame_begin, ret, &caller, &frame_end) != 3
+      || frame_end == 0) {
+    return false;
+  }
+
+  return_address = static_cast<cell>(std::strtoul(ret, 0, 16));
+  caller_address = static_cast<cell>(caller);
+
+  begin = hash + frame_begin;
+  end = hash + frame_end;
+  return true;
+}
+
+void PrintFrame(std::ostream &stream, Script *script,
+                cell return_address, cell caller_address) {
+  AMXScript amx(&script->amx);
+  AMXStackFrame frame(amx, 0, return_address, 0, caller_address);
+
+  AMXStackFramePrinter printer;
+  printer.set_stream(&stream);
+  printer.set_debug_info(&script->debug_info);
+
+  printer.PrintReturnAddress(frame);
+  stream << " in ";
+
+  AMXDebugSymbol caller;
+  if (script->debug_info.IsLoaded()) {
+    caller = script->debug_info.GetExactFunction(frame.caller_address());
+  }
+  if (caller) {
+    printer.PrintCallerName(frame, caller);
+  } else {
+    printer.PrintCallerName(frame);
+  }
+  stream << " ()";
+
+  if (script->debug_info.IsLoaded() && frame.return_address() != 0) {
+    stream << " at ";
+    printer.PrintSourceLocation(frame.return_address());
+  }
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <script.amx>... < server_log.txt"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  ScriptMap scripts;
+
+  for (int i = 1; i < argc; i++) {
+    Script *script = LoadScript(argv[i]);
+    if (script == 0) {
+      std::cerr << "Could not load " << argv[i] << std::endl;
+      continue;
+    }
+    if (!script->debug_info.IsLoaded()) {
+      std::cerr << argv[i] << " has no debug info" << std::endl;
+    }
+    uint32_t fingerprint = GetAmxFingerprint(&script->amx);
+    if (!scripts.insert(std::make_pair(fingerprint, script)).second) {
+      FreeScript(script);
+    }
+  }
+
+  Script *current = 0;
+  std::string line;
+
+  while (std::getline(std::cin, line)) {
+    uint32_t fingerprint;
+    if (ParseFingerprint(line, fingerprint)) {
+      ScriptMap::const_iterator it = scripts.find(fingerprint);
+      current = (it != scripts.end()) ? it->second : 0;
+      std::cout << line << std::endl;
+      continue;
+    }
+
+    std::string::size_type begin, end;
+    cell return_address, caller_address;
+    if (current != 0 &&
+        ParseFrame(line, begin, end, return_address, caller_address)) {
+      std::cout << line.substr(0, begin);
+      PrintFrame(std::cout, current, return_address, caller_address);
+      std::cout << line.substr(end) << std::endl;
+      continue;
+    }
+
+    if (line.find("backtrace") != std::string::npos) {
+      current = 0;
+    }
+    std::cout << line << std::endl;
+  }
+
+  for (ScriptMap::iterator it = scripts.begin(); it != scripts.end(); ++it) {
+    FreeScript(it->second);
+  }
+
+  return EXIT_SUCCESS;
+}
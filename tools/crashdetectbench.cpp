@@ -0,0 +1,765 @@
+// Copyright (c) 2013 Zeex
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// crashdetectbench - measures how much CrashDetect adds to the cost of
+// running scripts: native calls, public calls, runtime errors and AMX
+// backtraces (1 and 50 frames deep) and a loop of arithmetic, each with
+// CrashDetect not loaded ("none"), loaded but disabled (crashdetect_enabled
+// 0) and enabled. The loop is also run on a copy of the script loaded with
+// crashdetect_superinstructions 1. It also measures debug info lookups and
+// how long FindAmx() takes with a number of .amx files in the search path.
+// Results are printed as JSON.
+//
+// Usage: crashdetectbench [-d <dir>] [-f <files>] [-s <functions>] [-t <ms>]
+//
+// The benchmark script (plus copies for FindAmx) is generated in <dir>,
+// which is created and removed by the benchmark. Scripts are called the
+// same way the plugin's amx_Exec hook does it; log output is discarded.
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+  #include <direct.h>
+#else
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include <amx/amx.h>
+#include <amx/amxaux.h>
+#include <amx/amxdbg.h>
+
+#include "plugin/amxdebuginfo.h"
+#include "plugin/amxopcode.h"
+#include "plugin/amxpathfinder.h"
+#include "plugin/configreader.h"
+#include "plugin/crashdetect.h"
+#include "plugin/logprintf.h"
+#include "plugin/os.h"
+#include "pluginversion.h"
+
+#include "benchmark.h"
+
+namespace {
+
+// Native calls made by a single call to Natives().
+const int kNativesPerCall = 100;
+
+// Iterations of the loop in Loop().
+const int kLoopIterations = 1000;
+
+const int kDeepBacktrace = 50;
+const int kNumLookups = 4096;
+
+enum Mode {
+  kModeNone,
+  kModeDisabled,
+  kModeEnabled,
+  kNumModes
+};
+
+const char *const kModeNames[kNumModes] = {"none", "disabled", "enabled"};
+
+typedef int (AMXAPI *ExecFunc)(AMX *amx, cell *retval, int index);
+
+volatile cell sink;
+
+// Generates a script along with its debug info: every instruction is on
+// a line of its own and every function has a symbol.
+class ScriptBuilder {
+ public:
+  ScriptBuilder();
+
+  void AddNative(const std::string &name);
+
+  void BeginFunction(const std::string &name, bool is_public);
+  void AddParameter(const std::string &name, cell address);
+  void EndFunction();
+
+  cell Emit(AMXOpcode opcode);
+  cell Emit(AMXOpcode opcode, cell operand);
+  void Patch(cell address, cell operand);
+
+  cell address() const {
+    return static_cast<cell>(code_.size() * sizeof(cell));
+  }
+
+  // Returns the contents of the .amx file. Copies of a script differ only
+  // in stack size.
+  std::vector<unsigned char> Build(cell stack_size) const;
+
+ private:
+  struct Symbol {
+    std::string name;
+    cell address;
+    cell codestart;
+    cell codeend;
+    char ident;
+    char vclass;
+  };
+
+  std::vector<cell> code_;
+  std::vector<AMX_DBG_LINE> lines_;
+  std::vector<Symbol> symbols_;
+  std::vector<std::pair<std::string, cell> > publics_;
+  std::vector<std::string> natives_;
+  std::size_t function_;
+};
+
+template<typename T>
+void Append(std::vector<unsigned char> &buffer, T value) {
+  const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+}
+
+void Append(std::vector<unsigned char> &buffer, const std::string &string) {
+  buffer.insert(buffer.end(), string.begin(), string.end());
+  buffer.push_back('\0');
+}
+
+ScriptBuilder::ScriptBuilder(): function_(0) {
+  // Publics return to address 0.
+  Emit(AMX_OP_HALT, 0);
+}
+
+void ScriptBuilder::AddNative(const std::string &name) {
+  natives_.push_back(name);
+}
+
+void ScriptBuilder::BeginFunction(const std::string &name, bool is_public) {
+  Symbol symbol = {name, address(), address(), 0,
+                   AMXDebugInfo::Symbol::Function,
+                   AMXDebugInfo::Symbol::Global};
+  function_ = symbols_.size();
+  symbols_.push_back(symbol);
+  if (is_public) {
+    publics_.push_back(std::make_pair(name, address()));
+  }
+  Emit(AMX_OP_PROC);
+}
+
+void ScriptBuilder::AddParameter(const std::string &name, cell address) {
+  Symbol symbol = {name, address, symbols_[function_].codestart, 0,
+                   AMXDebugInfo::Symbol::Variable,
+                   AMXDebugInfo::Symbol::Local};
+  symbols_.push_back(symbol);
+}
+
+void ScriptBuilder::EndFunction() {
+  for (std::size_t i = function_; i < symbols_.size(); i++) {
+    symbols_[i].codeend = address();
+  }
+}
+
+cell ScriptBuilder::Emit(AMXOpcode opcode) {
+  AMX_DBG_LINE line;
+  line.address = address();
+  line.line = static_cast<int32_t>(lines_.size() + 1);
+  lines_.push_back(line);
+  code_.push_back(opcode);
+  return line.address;
+}
+
+cell ScriptBuilder::Emit(AMXOpcode opcode, cell operand) {
+  cell start = Emit(opcode);
+  code_.push_back(operand);
+  return start;
+}
+
+void ScriptBuilder::Patch(cell address, cell operand) {
+  code_[address / sizeof(cell) + 1] = operand;
+}
+
+std::vector<unsigned char> ScriptBuilder::Build(cell stack_size) const {
+  std::vector<std::pair<std::string, cell> > publics(publics_);
+  std::sort(publics.begin(), publics.end());
+
+  int32_t publics_offset = sizeof(AMX_HEADER);
+  int32_t natives_offset = publics_offset +
+    static_cast<int32_t>(publics.size() * sizeof(AMX_FUNCSTUBNT));
+  int32_t nametable = natives_offset +
+    static_cast<int32_t>(natives_.size() * sizeof(AMX_FUNCSTUBNT));
+
+  std::vector<unsigned char> names;
+  Append(names, static_cast<uint16_t>(sNAMEMAX));
+  std::vector<uint32_t> name_offsets;
+  for (std::size_t i = 0; i < publics.size(); i++) {
+    name_offsets.push_back(nametable + static_cast<uint32_t>(names.size()));
+    Append(names, publics[i].first);
+  }
+  for (std::size_t i = 0; i < natives_.size(); i++) {
+    name_offsets.push_back(nametable + static_cast<uint32_t>(names.size()));
+    Append(names, natives_[i]);
+  }
+  while (names.size() % sizeof(cell) != 0) {
+    names.push_back('\0');
+  }
+
+  AMX_HEADER hdr;
+  std::memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = AMX_MAGIC;
+  hdr.file_version = CUR_FILE_VERSION;
+  hdr.amx_version = MIN_AMX_VERSION;
+  hdr.flags = AMX_FLAG_DEBUG;
+  hdr.defsize = sizeof(AMX_FUNCSTUBNT);
+  hdr.cod = nametable + static_cast<int32_t>(names.size());
+  hdr.dat = hdr.cod + static_cast<int32_t>(code_.size() * sizeof(cell));
+  hdr.hea = hdr.dat;
+  hdr.stp = hdr.hea + stack_size;
+  hdr.cip = -1;
+  hdr.publics = publics_offset;
+  hdr.natives = natives_offset;
+  hdr.libraries = nametable;
+  hdr.pubvars = nametable;
+  hdr.tags = nametable;
+  hdr.nametable = nametable;
+  hdr.size = hdr.hea;
+
+  std::vector<unsigned char> script;
+  Append(script, hdr);
+  for (std::size_t i = 0; i < publics.size(); i++) {
+    AMX_FUNCSTUBNT stub = {static_cast<ucell>(publics[i].second),
+                           name_offsets[i]};
+    Append(script, stub);
+  }
+  for (std::size_t i = 0; i < natives_.size(); i++) {
+    AMX_FUNCSTUBNT stub = {0, name_offsets[publics.size() + i]};
+    Append(script, stub);
+  }
+  script.insert(script.end(), names.begin(), names.end());
+  for (std::size_t i = 0; i < code_.size(); i++) {
+    Append(script, code_[i]);
+  }
+
+  std::vector<unsigned char> debug_info;
+  Append(debug_info, static_cast<ucell>(0));
+  Append(debug_info, std::string("crashdetectbench.pwn"));
+  for (std::size_t i = 0; i < lines_.size(); i++) {
+    Append(debug_info, lines_[i].address);
+    Append(debug_info, lines_[i].line);
+  }
+  for (std::size_t i = 0; i < symbols_.size(); i++) {
+    Append(debug_info, symbols_[i].address);
+    Append(debug_info, static_cast<uint16_t>(0));
+    Append(debug_info, symbols_[i].codestart);
+    Append(debug_info, symbols_[i].codeend);
+    Append(debug_info, symbols_[i].ident);
+    Append(debug_info, symbols_[i].vclass);
+    Append(debug_info, static_cast<uint16_t>(0));
+    Append(debug_info, symbols_[i].name);
+  }
+  Append(debug_info, static_cast<uint16_t>(0));
+  Append(debug_info, std::string("_"));
+
+  AMX_DBG_HDR dbg_hdr;
+  std::memset(&dbg_hdr, 0, sizeof(dbg_hdr));
+  dbg_hdr.size = static_cast<int32_t>(sizeof(dbg_hdr) + debug_info.size());
+  dbg_hdr.magic = AMX_DBG_MAGIC;
+  dbg_hdr.file_version = CUR_FILE_VERSION;
+  dbg_hdr.amx_version = MIN_AMX_VERSION;
+  dbg_hdr.files = 1;
+  dbg_hdr.lines = static_cast<uint16_t>(lines_.size());
+  dbg_hdr.symbols = static_cast<uint16_t>(symbols_.size());
+  dbg_hdr.tags = 1;
+  Append(script, dbg_hdr);
+  script.insert(script.end(), debug_info.begin(), debug_info.end());
+
+  return script;
+}
+
+// Natives(), Empty(), Error(), Loop() and Backtrace(depth) are what is
+// measured.
+// The filler functions stand for the rest of a big gamemode and are placed
+// first so that looking up a function in the debug info is not too easy.
+void GenerateScript(ScriptBuilder &builder, int num_functions) {
+  builder.AddNative("Nop");
+  builder.AddNative("GetBacktrace");
+
+  for (int i = 0; i < num_functions; i++) {
+    char name[sNAMEMAX + 1];
+    std::sprintf(name, "Filler%d", i);
+    builder.BeginFunction(name, false);
+    builder.Emit(AMX_OP_ZERO_PRI);
+    builder.Emit(AMX_OP_RETN);
+    builder.EndFunction();
+  }
+
+  builder.BeginFunction("Natives", true);
+  for (int i = 0; i < kNativesPerCall; i++) {
+    builder.Emit(AMX_OP_PUSH_C, 0);
+    builder.Emit(AMX_OP_SYSREQ_C, 0);
+    builder.Emit(AMX_OP_STACK, sizeof(cell));
+  }
+  builder.Emit(AMX_OP_ZERO_PRI);
+  builder.Emit(AMX_OP_RETN);
+  builder.EndFunction();
+
+  builder.BeginFunction("Empty", true);
+  builder.Emit(AMX_OP_ZERO_PRI);
+  builder.Emit(AMX_OP_RETN);
+  builder.EndFunction();
+
+  builder.BeginFunction("Error", true);
+  builder.Emit(AMX_OP_CONST_PRI, 1);
+  builder.Emit(AMX_OP_BOUNDS, 0);
+  builder.Emit(AMX_OP_RETN);
+  builder.EndFunction();
+
+  // Loop() is what the compiler makes of
+  //
+  //   new sum = 0;
+  //   for (new i = 0; i < kLoopIterations; i++) {
+  //     sum += i;
+  //   }
+  cell sum = -static_cast<cell>(sizeof(cell));
+  cell i = -2 * static_cast<cell>(sizeof(cell));
+  builder.BeginFunction("Loop", true);
+  builder.Emit(AMX_OP_PUSH_C, 0);
+  builder.Emit(AMX_OP_PUSH_C, 0);
+  cell loop = builder.Emit(AMX_OP_LOAD_S_PRI, i);
+  builder.Emit(AMX_OP_CONST_ALT, kLoopIterations);
+  cell jsgeq = builder.Emit(AMX_OP_JSGEQ, 0);
+  builder.Emit(AMX_OP_LOAD_S_ALT, sum);
+  builder.Emit(AMX_OP_LOAD_S_PRI, i);
+  builder.Emit(AMX_OP_ADD);
+  builder.Emit(AMX_OP_STOR_S_PRI, sum);
+  builder.Emit(AMX_OP_INC_S, i);
+  builder.Emit(AMX_OP_JUMP, loop);
+  builder.Patch(jsgeq, builder.address());
+  builder.Emit(AMX_OP_STACK, 2 * sizeof(cell));
+  builder.Emit(AMX_OP_ZERO_PRI);
+  builder.Emit(AMX_OP_RETN);
+  builder.EndFunction();
+
+  // Recurse(n) calls itself until n is 0 and then calls GetBacktrace().
+  cell recurse = builder.address();
+  builder.BeginFunction("Recurse", false);
+  builder.AddParameter("n", 3 * sizeof(cell));
+  builder.Emit(AMX_OP_LOAD_S_PRI, 3 * sizeof(cell));
+  cell jzer = builder.Emit(AMX_OP_JZER, 0);
+  builder.Emit(AMX_OP_ADD_C, -1);
+  builder.Emit(AMX_OP_PUSH_PRI);
+  builder.Emit(AMX_OP_PUSH_C, sizeof(cell));
+  builder.Emit(AMX_OP_CALL, recurse);
+  builder.Emit(AMX_OP_RETN);
+  builder.Patch(jzer, builder.address());
+  builder.Emit(AMX_OP_PUSH_C, 0);
+  builder.Emit(AMX_OP_SYSREQ_C, 1);
+  builder.Emit(AMX_OP_STACK, sizeof(cell));
+  builder.Emit(AMX_OP_RETN);
+  builder.EndFunction();
+
+  // Backtrace(depth) calls Recurse(depth - 1).
+  builder.BeginFunction("Backtrace", true);
+  builder.AddParameter("depth", 3 * sizeof(cell));
+  builder.Emit(AMX_OP_LOAD_S_PRI, 3 * sizeof(cell));
+  builder.Emit(AMX_OP_ADD_C, -1);
+  builder.Emit(AMX_OP_PUSH_PRI);
+  builder.Emit(AMX_OP_PUSH_C, sizeof(cell));
+  builder.Emit(AMX_OP_CALL, recurse);
+  builder.Emit(AMX_OP_RETN);
+  builder.EndFunction();
+}
+
+bool WriteFile(const std::string &filename,
+               const std::vector<unsigned char> &data) {
+  std::FILE *fp = std::fopen(filename.c_str(), "wb");
+  if (fp == 0) {
+    return false;
+  }
+  bool ok = std::fwrite(&data[0], 1, data.size(), fp) == data.size();
+  return std::fclose(fp) == 0 && ok;
+}
+
+bool MakeDirectory(const std::string &path) {
+  #ifdef _WIN32
+    return _mkdir(path.c_str()) == 0;
+  #else
+    return mkdir(path.c_str(), 0755) == 0;
+  #endif
+}
+
+// Removes the files and then the directory they were in.
+void RemoveFiles(const std::string &directory,
+                 const std::vector<std::string> &files) {
+  for (std::size_t i = 0; i < files.size(); i++) {
+    std::remove(files[i].c_str());
+  }
+  #ifdef _WIN32
+    _rmdir(directory.c_str());
+  #else
+    rmdir(directory.c_str());
+  #endif
+}
+
+bool crashdetect_loaded = false;
+
+void Discard(const char *format, ...) {
+}
+
+cell AMX_NATIVE_CALL Nop(AMX *amx, cell *params) {
+  return 0;
+}
+
+// Does what GetAmxBacktrace() does, minus copying the string to the script.
+cell AMX_NATIVE_CALL GetBacktrace(AMX *amx, cell *params) {
+  if (crashdetect_loaded) {
+    std::stringstream stream;
+    CrashDetect::PrintAmxBacktrace(stream);
+    return static_cast<cell>(stream.str().length());
+  }
+  return 0;
+}
+
+const AMX_NATIVE_INFO natives[] = {
+  {"Nop",          Nop},
+  {"GetBacktrace", GetBacktrace},
+  {0,              0}
+};
+
+// Same as the plugin's amx_Exec() hook.
+int AMXAPI ExecCrashDetect(AMX *amx, cell *retval, int index) {
+  if ((amx->flags & AMX_FLAG_BROWSE) || !CrashDetect::IsEnabled()) {
+    return amx_Exec(amx, retval, index);
+  }
+  return CrashDetect::Get(amx)->DoAmxExec(retval, index);
+}
+
+void AMXAPI ExecError(AMX *amx, cell index, cell *retval, int error) {
+  CrashDetect::Get(amx)->HandleExecError(index, retval, error);
+}
+
+class CallPublic {
+ public:
+  static const int kBatchSize = 64;
+
+  CallPublic(AMX *amx, ExecFunc exec, const char *name, cell arg)
+    : amx_(amx), exec_(exec), index_(-1), arg_(arg)
+  {
+    amx_FindPublic(amx, name, &index_);
+  }
+
+  void operator()() {
+    for (int i = 0; i < kBatchSize; i++) {
+      if (arg_ >= 0) {
+        amx_Push(amx_, arg_);
+      }
+      cell retval;
+      exec_(amx_, &retval, index_);
+    }
+  }
+
+ private:
+  AMX *amx_;
+  ExecFunc exec_;
+  int index_;
+  cell arg_;
+};
+
+// Does what a backtrace does for each frame.
+class LookUpDebugInfo {
+ public:
+  LookUpDebugInfo(const AMXDebugInfo &debug_info,
+                  const std::vector<cell> &addresses)
+    : debug_info_(debug_info), addresses_(addresses)
+  {
+  }
+
+  void operator()() {
+    for (std::size_t i = 0; i < addresses_.size(); i++) {
+      cell address = addresses_[i];
+      AMXDebugInfo::Symbol function = debug_info_.GetFunction(address);
+      AMXDebugInfo::File file = debug_info_.GetFile(address);
+      sink = debug_info_.GetLineNumber(address) +
+             (function ? function.GetCodeStart() : 0) +
+             (file ? file.GetAddress() : 0);
+    }
+  }
+
+ private:
+  const AMXDebugInfo &debug_info_;
+  const std::vector<cell> &addresses_;
+};
+
+class FindAmx {
+ public:
+  FindAmx(AMX *amx, const std::string &directory, bool cached)
+    : amx_(amx), directory_(directory), path_finder_(0)
+  {
+    if (cached) {
+      path_finder_ = new AMXPathFinder;
+      path_finder_->AddSearchPath(directory_);
+    }
+  }
+
+  ~FindAmx() {
+    delete path_finder_;
+  }
+
+  void operator()() {
+    if (path_finder_ != 0) {
+      path_finder_->Forget(amx_);
+      sink = static_cast<cell>(path_finder_->FindAmx(amx_).length());
+    } else {
+      AMXPathFinder path_finder;
+      path_finder.AddSearchPath(directory_);
+      sink = static_cast<cell>(path_finder.FindAmx(amx_).length());
+    }
+  }
+
+ private:
+  AMX *amx_;
+  std::string directory_;
+  AMXPathFinder *path_finder_;
+};
+
+struct Result {
+  std::string name;
+  std::string unit;
+  int files;
+  bool has_value[kNumModes];
+  double value[kNumModes];
+};
+
+Result MakeResult(const std::string &name, const std::string &unit) {
+  Result result;
+  result.name = name;
+  result.unit = unit;
+  result.files = 0;
+  for (int i = 0; i < kNumModes; i++) {
+    result.has_value[i] = false;
+    result.value[i] = 0;
+  }
+  return result;
+}
+
+void PrintResults(const std::vector<Result> &results, int num_functions,
+                  std::uint64_t min_time) {
+  std::cout << std::fixed << std::setprecision(3)
+            << "{\n"
+            << "  \"version\": \"" << PROJECT_VERSION_STRING << "\",\n"
+            << "  \"functions\": " << num_functions << ",\n"
+            << "  \"min_time_us\": " << min_time << ",\n"
+            << "  \"results\": [\n";
+  for (std::size_t i = 0; i < results.size(); i++) {
+    const Result &result = results[i];
+    std::cout << "    {\"name\": \"" << result.name << "\", "
+              << "\"unit\": \"" << result.unit << "\"";
+    if (result.files > 0) {
+      std::cout << ", \"files\": " << result.files;
+    }
+    for (int j = 0; j < kNumModes; j++) {
+      if (result.has_value[j]) {
+        std::cout << ", \"" << kModeNames[j] << "\": " << result.value[j];
+      }
+    }
+    std::cout << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  std::cout << "  ]\n"
+            << "}" << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  std::string directory = "crashdetectbench.tmp";
+  int num_files = 100;
+  int num_functions = 1000;
+  std::uint64_t min_time = 200000;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      directory = argv[++i];
+    } else if (std::strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      num_files = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      num_functions = std::max(0, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      min_time = std::max(1, std::atoi(argv[++i])) * 1000;
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [-d <dir>] [-f <files>]"
+                << " [-s <functions>] [-t <ms>]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  ScriptBuilder builder;
+  GenerateScript(builder, num_functions);
+
+  if (!MakeDirectory(directory)) {
+    std::cerr << "Could not create " << directory << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::string> files;
+  for (int i = 0; i < num_files; i++) {
+    char name[32];
+    std::sprintf(name, "script%04d.amx", i);
+    std::string filename = directory + "/" + name;
+    if (!WriteFile(filename, builder.Build((1024 + i) * sizeof(cell)))) {
+      std::cerr << "Could not write " << filename << std::endl;
+      RemoveFiles(directory, files);
+      return EXIT_FAILURE;
+    }
+    files.push_back(filename);
+  }
+
+  std::string config_file = directory + "/bench.cfg";
+  std::FILE *fp = std::fopen(config_file.c_str(), "w");
+  if (fp != 0) {
+    std::fprintf(fp, "crashdetect_symbol_path %s\n", directory.c_str());
+    std::fclose(fp);
+  }
+
+  AMX amx_none;
+  AMX amx_cd;
+  AMX amx_super;
+  AMX amx_find;
+  std::memset(&amx_none, 0, sizeof(amx_none));
+  std::memset(&amx_cd, 0, sizeof(amx_cd));
+  std::memset(&amx_super, 0, sizeof(amx_super));
+  std::memset(&amx_find, 0, sizeof(amx_find));
+  if (aux_LoadProgram(&amx_none, files.front().c_str(), 0) != AMX_ERR_NONE ||
+      aux_LoadProgram(&amx_cd, files.front().c_str(), 0) != AMX_ERR_NONE ||
+      aux_LoadProgram(&amx_super, files.front().c_str(), 0) != AMX_ERR_NONE ||
+      aux_LoadProgram(&amx_find, files.back().c_str(), 0) != AMX_ERR_NONE) {
+    std::cerr << "Could not load the generated script" << std::endl;
+    std::remove(config_file.c_str());
+    RemoveFiles(directory, files);
+    return EXIT_FAILURE;
+  }
+  amx_Register(&amx_none, natives, -1);
+  amx_Register(&amx_cd, natives, -1);
+  amx_Register(&amx_super, natives, -1);
+
+  ::logprintf = Discard;
+  CrashDetect::Configure(ConfigReader(config_file));
+  CrashDetect::SetSuperinstructions(false);
+  CrashDetect::Create(&amx_cd)->Load();
+  amx_SetExecErrorHandler(&amx_cd, ExecError);
+  CrashDetect::SetSuperinstructions(true);
+  CrashDetect::Create(&amx_super)->Load();
+  amx_SetExecErrorHandler(&amx_super, ExecError);
+  CrashDetect::FinishStartup();
+
+  std::vector<Result> results;
+
+  struct {
+    const char *name;
+    const char *public_name;
+    cell arg;
+    int ops;
+  } scenarios[] = {
+    {"native_call",   "Natives",   -1,             kNativesPerCall},
+    {"public_call",   "Empty",     -1,             1},
+    {"runtime_error", "Error",     -1,             1},
+    {"loop",          "Loop",      -1,             kLoopIterations},
+    {"backtrace_1",   "Backtrace", 1,              1},
+    {"backtrace_50",  "Backtrace", kDeepBacktrace, 1}
+  };
+
+  for (std::size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+    Result result = MakeResult(scenarios[i].name, "ns");
+    for (int mode = 0; mode < kNumModes; mode++) {
+      AMX *amx = &amx_cd;
+      ExecFunc exec = ExecCrashDetect;
+      crashdetect_loaded = (mode != kModeNone);
+      if (mode == kModeNone) {
+        amx = &amx_none;
+        exec = amx_Exec;
+      } else {
+        CrashDetect::SetEnabled(mode == kModeEnabled);
+      }
+      CallPublic call(amx, exec, scenarios[i].public_name, scenarios[i].arg);
+      double time = Measure(call, min_time);
+      result.has_value[mode] = true;
+      result.value[mode] = time * 1000 / CallPublic::kBatchSize /
+                           scenarios[i].ops;
+    }
+    results.push_back(result);
+  }
+
+  Result loop_super = MakeResult("loop_superinstructions", "ns");
+  for (int mode = kModeDisabled; mode < kNumModes; mode++) {
+    CrashDetect::SetEnabled(mode == kModeEnabled);
+    CallPublic call(&amx_super, ExecCrashDetect, "Loop", -1);
+    double time = Measure(call, min_time);
+    loop_super.has_value[mode] = true;
+    loop_super.value[mode] = time * 1000 / CallPublic::kBatchSize /
+                             kLoopIterations;
+  }
+  results.push_back(loop_super);
+  CrashDetect::SetEnabled(true);
+
+  AMXDebugInfo debug_info(files.front());
+  if (debug_info.IsLoaded()) {
+    AMX_HEADER *hdr = reinterpret_cast<AMX_HEADER*>(amx_none.base);
+    std::srand(1);
+    std::vector<cell> addresses;
+    for (int i = 0; i < kNumLookups; i++) {
+      addresses.push_back(static_cast<cell>(
+        (static_cast<double>(std::rand()) / RAND_MAX) * (hdr->dat - hdr->cod)));
+    }
+    LookUpDebugInfo lookup(debug_info, addresses);
+    Result result = MakeResult("debug_info_lookup", "ns");
+    result.has_value[kModeEnabled] = true;
+    result.value[kModeEnabled] = Measure(lookup, min_time) * 1000 / kNumLookups;
+    results.push_back(result);
+  }
+
+  for (int cached = 0; cached <= 1; cached++) {
+    FindAmx find(&amx_find, directory, cached != 0);
+    Result result = MakeResult(cached ? "find_amx_cached" : "find_amx", "us");
+    result.files = num_files;
+    result.has_value[kModeEnabled] = true;
+    result.value[kModeEnabled] = Measure(find, min_time);
+    results.push_back(result);
+  }
+
+  PrintResults(results, num_functions, min_time);
+
+  CrashDetect::Get(&amx_cd)->Unload();
+  CrashDetect::Destroy(&amx_cd);
+  CrashDetect::Get(&amx_super)->Unload();
+  CrashDetect::Destroy(&amx_super);
+  aux_FreeProgram(&amx_none);
+  aux_FreeProgram(&amx_cd);
+  aux_FreeProgram(&amx_super);
+  aux_FreeProgram(&amx_find);
+
+  std::remove(config_file.c_str());
+  RemoveFiles(directory, files);
+
+  return EXIT_SUCCESS;
+}
@@ -25,7 +25,9 @@
 # POSSIBILITY OF SUCH DAMAGE.
 
 import argparse
+import os
 import re
+import struct
 import sys
 
 class Register:
@@ -103,6 +105,244 @@ class CrashInfo:
       if module is not None:
         yield address, module
 
+class AmxFile:
+  """Reads the parts of an .amx file needed to symbolize code addresses:
+  the public and native function tables and the debug info, if any."""
+
+  AMX_FLAG_DEBUG = 0x02
+  AMX_DBG_MAGIC = 0xf1ef
+  FUNCTION = 9
+
+  def __init__(self, filename):
+    with open(filename, 'rb') as file:
+      self._data = file.read()
+    (size, magic, file_version, amx_version, flags, defsize, cod, dat, hea,
+     stp, cip, publics, natives, libraries, pubvars, tags,
+     nametable) = struct.unpack_from('<iHbbhhiiiiiiiiiii', self._data, 0)
+    self._publics = self._read_func_table(publics, natives, defsize)
+    self._natives = self._read_func_table(natives, libraries, defsize)
+    self._files = []
+    self._lines = []
+    self._functions = []
+    if flags & AmxFile.AMX_FLAG_DEBUG and len(self._data) > size:
+      self._read_debug_info(size)
+
+  def _read_string(self, offset):
+    end = self._data.index(b'\0', offset)
+    return self._data[offset:end].decode('latin-1'), end + 1
+
+  def _read_func_table(self, start, end, defsize):
+    table = []
+    for offset in range(start, end, defsize):
+      address, nameofs = struct.unpack_from('<II', self._data, offset)
+      table.append((address, self._read_string(nameofs)[0]))
+    return table
+
+  def _read_debug_info(self, offset):
+    (size, magic, file_version, amx_version, flags, files, lines, symbols,
+     tags, automatons, states) = struct.unpack_from('<IHbbHHHHHHH', self._data, offset)
+    if magic != AmxFile.AMX_DBG_MAGIC:
+      return
+    offset += 22
+    for i in range(files):
+      address, = struct.unpack_from('<I', self._data, offset)
+      name, offset = self._read_string(offset + 4)
+      self._files.append((address, name))
+    for i in range(lines):
+      self._lines.append(struct.unpack_from('<Ii', self._data, offset))
+      offset += 8
+    for i in range(symbols):
+      (address, tag, codestart, codeend, ident, vclass,
+       dim) = struct.unpack_from('<IHIIbbH', self._data, offset)
+      name, offset = self._read_string(offset + 18)
+      offset += dim * 6
+      # Skip bogus forward declarations of publics (see amxdebuginfo.cpp).
+      if ident == AmxFile.FUNCTION and not name.startswith('@'):
+        self._functions.append((codestart, codeend, name))
+
+  @property
+  def has_debug_info(self):
+    return len(self._lines) > 0
+
+  def get_public_name(self, index):
+    if index == -1:
+      return 'main'
+    if index >= 0 and index < len(self._publics):
+      return self._publics[index][1]
+
+  def get_native_name(self, index):
+    if index >= 0 and index < len(self._natives):
+      return self._natives[index][1]
+
+  def get_function_name(self, address):
+    for start, end, name in self._functions:
+      if start <= address and address < end:
+        for public_address, public_name in self._publics:
+          if public_address == start:
+            return 'public ' + name
+        return name
+
+  def get_source_location(self, address):
+    if not self.has_debug_info:
+      return None
+    filename = '<unknown file>'
+    for file_address, name in self._files:
+      if file_address > address:
+        break
+      filename = name
+    line = 0
+    for line_address, number in self._lines:
+      if line_address > address:
+        break
+      line = number
+    return '%s:%d' % (filename, line + 1)
+
+class AmxCall:
+  def __init__(self, type, amx, index, frm, cip):
+    self.is_public = (type == 1)
+    self.amx = amx
+    self.index = struct.unpack('<i', struct.pack('<I', index))[0]
+    self.frm = frm
+    self.cip = cip
+
+class CrashDump(CrashInfo):
+  """Reads the binary snapshot written by CrashDetect when the
+  crashdetect_dump option is set in server.cfg (see plugin/crashdump.h)."""
+
+  END = 0
+  REGISTERS = 1
+  NATIVE_STACK = 2
+  MODULES = 3
+  AMX_STATE = 4
+  AMX_CALLS = 5
+  AMX_HEAP = 6
+  AMX_STACK = 7
+  AMX_BREAKS = 8
+
+  REGISTER_NAMES = ['eip', 'esp', 'ebp', 'eax', 'ebx', 'ecx', 'edx', 'esi',
+                    'edi', 'eflags']
+
+  def __init__(self):
+    CrashInfo.__init__(self)
+    self._amx_state = None
+    self._amx_name = None
+    self._amx_calls = []
+    self._amx_memory = []
+    self._amx_breaks = []
+
+  def add_record(self, type, data):
+    if type == CrashDump.REGISTERS:
+      values = struct.unpack_from('<10I', data, 0)
+      for name, value in zip(CrashDump.REGISTER_NAMES, values):
+        self._registers.append(Register(name, value))
+    elif type == CrashDump.NATIVE_STACK:
+      for i in range(4, len(data) - 3, 4):
+        self._stack.append(struct.unpack_from('<I', data, i)[0])
+    elif type == CrashDump.MODULES:
+      self._add_modules(data.decode('latin-1'))
+    elif type == CrashDump.AMX_STATE:
+      names = ['amx', 'cip', 'frm', 'stk', 'hea', 'hlw', 'stp', 'pri', 'alt']
+      self._amx_state = dict(zip(names, struct.unpack_from('<9I', data, 0)))
+      self._amx_name = data[36:].split(b'\0')[0].decode('latin-1')
+    elif type == CrashDump.AMX_CALLS:
+      for i in range(0, len(data) - 19, 20):
+        self._amx_calls.append(AmxCall(*struct.unpack_from('<5I', data, i)))
+    elif type in (CrashDump.AMX_HEAP, CrashDump.AMX_STACK):
+      address, = struct.unpack_from('<I', data, 0)
+      self._amx_memory.append((address, data[4:]))
+    elif type == CrashDump.AMX_BREAKS:
+      self._amx_breaks = list(struct.unpack_from('<%dI' % (len(data) // 4), data, 0))
+
+  def _add_modules(self, text):
+    for line in text.splitlines():
+      match = re.match(r'(?P<start>[0-9a-fA-F]+)-(?P<end>[0-9a-fA-F]+)\s+(?P<perms>\S+)\s+\S+\s+\S+\s+\S+\s*(?P<path>.*)', line)
+      if match is None or 'x' not in match.group('perms'):
+        continue
+      path = match.group('path').strip()
+      if not path:
+        continue
+      start = int(match.group('start'), 16)
+      end = int(match.group('end'), 16)
+      if self._modules and self._modules[-1].path == path:
+        last = self._modules.pop()
+        start = min(start, last.location[0])
+        end = max(end, last.location[1])
+      self._modules.append(Module(os.path.basename(path), start, end, path))
+
+  def get_amx_name(self):
+    return self._amx_name
+
+  def read_amx_cell(self, address):
+    for start, data in self._amx_memory:
+      if address >= start and address + 4 <= start + len(data):
+        return struct.unpack_from('<i', data, address - start)[0]
+    return None
+
+  def get_original_address(self, address):
+    """Maps a code address of the running script back to the .amx file if
+    CrashDetect removed BREAK instructions from it."""
+    removed = 0
+    for break_address in self._amx_breaks:
+      if break_address > address + removed:
+        break
+      removed += 4
+    return address + removed
+
+  def get_amx_backtrace(self, amx_file=None):
+    """Walks the AMX call stack in the same way as CrashDetect does at run
+    time. Yields printable frame descriptions, innermost first."""
+    if self._amx_state is None:
+      return
+    top_amx = self._amx_state['amx']
+    cip = self._amx_state['cip']
+    frm = self._amx_state['frm']
+    for call in self._amx_calls:
+      if call.amx != top_amx or cip == 0:
+        break
+      if not call.is_public:
+        name = None
+        if amx_file is not None:
+          name = amx_file.get_native_name(call.index)
+        yield 'native %s ()' % (name or '#%d' % call.index)
+        continue
+      address = self.get_original_address(cip)
+      while True:
+        name = None
+        location = None
+        if amx_file is not None:
+          name = amx_file.get_function_name(address)
+          location = amx_file.get_source_location(address)
+        ret = self.read_amx_cell(frm + 4) if frm else None
+        if not ret and name is None and amx_file is not None:
+          name = 'public ' + (amx_file.get_public_name(call.index) or '??')
+        frame = '%08x in %s ()' % (address, name or '??')
+        if location is not None:
+          frame += ' at ' + location
+        yield frame
+        if not ret:
+          break
+        address = self.get_original_address(ret)
+        frm = self.read_amx_cell(frm)
+        if frm is None:
+          break
+      cip = call.cip
+      frm = call.frm
+
+def parse_crashdump(file):
+  data = file.read()
+  if data[:4] != b'CDMP':
+    raise ValueError('Not a CrashDetect dump file')
+  crashdump = CrashDump()
+  offset = 8
+  while offset + 8 <= len(data):
+    type, size = struct.unpack_from('<II', data, offset)
+    offset += 8
+    if type == CrashDump.END:
+      break
+    crashdump.add_record(type, data[offset:offset + size])
+    offset += size
+  return crashdump
+
 def search_register(name, string):
   match = re.search(r'%s: (?P<value>0x[0-9A-F]{8})' % name, string)
   if match is not None:
@@ -150,37 +390,59 @@ def parse_crashinfo(file):
         crashinfo.add_module(*match.groups())
   return crashinfo
 
+def print_crashinfo(crashinfo, args):
+  if args.version:
+    print('Server version: \n  %s' % crashinfo.get_version())
+  if args.registers:
+    print('Registers:')
+    for reg in crashinfo.get_registers():
+      print('  %s = %08x' % (reg.name, reg.value))
+  if args.stack:
+    print('Stack:')
+    for word in crashinfo.get_stack():
+      print('  %08x' % word)
+  if args.modules:
+    print('Modules:')
+    for module in crashinfo.get_modules():
+      start, end = module.location
+      print('  %s [%08x, %08x] (%s)' % (module.filename, start, end, module.path))
+  if args.callstack:
+    print('Call stack:')
+    for address, module in crashinfo.get_call_stack():
+      print('  %08x in %s' % (address, module.filename))
+
 def main(argv):
   arg_parser = argparse.ArgumentParser()
   arg_parser.add_argument('-f', '--file', default='crashinfo.txt', help='set input file')
+  arg_parser.add_argument('-d', '--dump', help='read binary crash dump written by CrashDetect instead of crashinfo.txt')
+  arg_parser.add_argument('-a', '--amx', help='set .amx file used to symbolize AMX backtrace (with --dump)')
   arg_parser.add_argument('-v', '--version', action='store_true', default=False, help='print server version')
   arg_parser.add_argument('-r', '--registers', action='store_true', default=False, help='print registers')
   arg_parser.add_argument('-s', '--stack', action='store_true', default=False, help='print raw stack')
   arg_parser.add_argument('-m', '--modules', action='store_true', default=False, help='print loaded modules')
   arg_parser.add_argument('-c', '--callstack', action='store_true', default=False, help='print call stack')
+  arg_parser.add_argument('-b', '--backtrace', action='store_true', default=False, help='print AMX backtrace (with --dump)')
   args = arg_parser.parse_args(argv[1:])
-  
-  with open(args.file, 'r') as file:
-    crashinfo = parse_crashinfo(file)
-    if args.version:
-      print('Server version: \n  %s' % crashinfo.get_version())
-    if args.registers:
-      print('Registers:')
-      for reg in crashinfo.get_registers():
-        print('  %s = %08x' % (reg.name, reg.value))
-    if args.stack:
-      print('Stack:')
-      for word in crashinfo.get_stack():
-        print('  %08x' % word)
-    if args.modules:
-      print('Modules:')
-      for module in crashinfo.get_modules():
-        start, end = module.location
-        print('  %s [%08x, %08x] (%s)' % (module.filename, start, end, module.path))
-    if args.callstack:
-      print 'Call stack:'
-      for address, module in crashinfo.get_call_stack():
-        print('  %08x in %s' % (address, module.filename))
+
+  if args.dump is None:
+    with open(args.file, 'r') as file:
+      print_crashinfo(parse_crashinfo(file), args)
+    return
+
+  with open(args.dump, 'rb') as file:
+    crashdump = parse_crashdump(file)
+  args.version = False
+  if not (args.registers or args.stack or args.modules or args.callstack or
+          args.backtrace):
+    args.registers = args.callstack = args.backtrace = True
+  print_crashinfo(crashdump, args)
+  if args.backtrace:
+    amx_file = None
+    if args.amx is not None:
+      amx_file = AmxFile(args.amx)
+    print('AMX backtrace (%s):' % (crashdump.get_amx_name() or '<unknown>'))
+    for level, frame in enumerate(crashdump.get_amx_backtrace(amx_file)):
+      print('  #%d %s' % (level, frame))
 
 if __name__ == '__main__':
   main(sys.argv)